@@ -0,0 +1,213 @@
+// calibrate.hh
+// the time step from pilot runs at several time steps
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_ENSEMBLE_CALIBRATE_HH
+# define PDLIB_ENSEMBLE_CALIBRATE_HH
+
+#include <vector>
+#include <map>
+#include <ostream>
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <stdint.h>
+
+#include <pdlib/random.hh>
+#include <pdlib/observables/stat.hh>
+#include <pdlib/observables/convergence.hh>
+#include <pdlib/reactions/network.hh>
+
+namespace PDL
+{
+	// Largest time step for which fixed steps realise all rates of a first
+	// order network within the relative tolerance rel: a species with total
+	// rate constant k reacts with probability 1 - exp (- k dt) per step, at
+	// the rate (1 - exp (- k dt)) / dt = k (1 - k dt / 2 + ...)
+	inline double saturationTimeStep (const ReactionNetwork & net, double rel)
+	{
+		std::vector<double> k (net.nSpecies(), 0.);
+		for (int r = 0; r < net.nReactions(); r++)
+			k[net.reaction (r).reactant] += net.reaction (r).k;
+		if (k.empty())
+			return HUGE_VAL;
+		double kmax = *std::max_element (k.begin(), k.end());
+		if (!(kmax > 0.) || !(rel > 0.))
+			return (kmax > 0.) ? 0. : HUGE_VAL;
+
+		// 1 - (1 - exp (- x)) / x = rel, increasing in x
+		double lo = 0., hi = 1.;
+		while (1. - (1. - exp (- hi)) / hi < rel && hi < 1e6)
+			hi *= 2.;
+		for (int i = 0; i < 60; i++)
+		{
+			double x = 0.5 * (lo + hi);
+			if (1. - (1. - exp (- x)) / x < rel)
+				lo = x;
+			else
+				hi = x;
+		}
+		return lo / kmax;
+	}
+
+	// Chooses the time step from short pilot runs. A Model is called as
+	// model (dt) and returns a vector of observables; as for Sweep, it must
+	// create its geometry, particles and reactions (with this dt) inside the
+	// call.
+	//
+	// Starting from the largest candidate, every dt is compared to dt/2 over
+	// the same replicas: replica r runs with the seed seed0 + r at both time
+	// steps (common random numbers), so the paired differences cancel the
+	// noise the two runs share; with a few replicas the rest is still about
+	// as large as the discretisation error. The schemes of PDL are first
+	// order in dt (Bernoulli reaction probabilities, reflected and rejected
+	// Brownian steps at walls), so O (dt) - O (0) ~ 2 (O (dt) - O (dt/2)).
+	// A time step is accepted if, for every observable, this error (plus
+	// the 95% half width of its estimate) is within max (rel |O|, abs), so
+	// noisy estimates make for smaller time steps.
+	//
+	// Pilot runs are kept, so trying dt after 2 dt runs dt/2 only. At least
+	// two replicas are needed for a half width.
+	template<class Model>
+		class TimeStepCalibration
+		{
+			public:
+				TimeStepCalibration (Model & model, int replicas, uint64_t seed0 = 1)
+					: model (model), replicas (replicas), seed0 (seed0),
+					relTol (0.01), absTol (0.), runs (0)
+				{
+					if (replicas < 2)
+						throw std::invalid_argument ("TimeStepCalibration: at least 2 replicas are needed");
+				};
+
+				void setTolerance (double rel, double abs = 0.)
+				{
+					relTol = rel;
+					absTol = abs;
+				}
+
+				// candidates dtmax, dtmax/2, ... down to (at least) dtmin
+				void setRange (double dtmax, double dtmin)
+				{
+					candidates.clear ();
+					for (double dt = dtmax; dt >= dtmin * (1. - 1e-12); dt *= 0.5)
+						candidates.push_back (dt);
+				}
+
+				// The largest candidate meeting the tolerance; the smallest
+				// candidate (with a warning) if none does
+				double run ()
+				{
+					errors.clear ();
+					for (unsigned int c = 0; c < candidates.size(); c++)
+					{
+						errors.push_back (estimate (candidates[c]));
+						if (accepted (c))
+							return candidates[c];
+					}
+					if (candidates.empty())
+						return 0.;
+					std::cerr << "TimeStepCalibration: no time step down to " << candidates.back()
+						<< " meets the tolerance" << std::endl;
+					return candidates.back();
+				}
+
+				int nCandidates () const {return candidates.size();};
+				double candidate (int c) const {return candidates.at (c);};
+				// candidates tried by run ()
+				int nTried () const {return errors.size();};
+				// estimated error of observable i at candidate c, with its half width
+				double error (int c, int i) const {return 2. * errors.at (c).at (i).mean();};
+				double errorHalfWidth (int c, int i) const {return 2. * halfWidth (errors.at (c).at (i));};
+				// mean of observable i over the pilots at dt
+				double mean (double dt, int i) const {return pilots.at (dt).at (i).mean();};
+				bool accepted (int c) const
+				{
+					const std::vector<RunningStat> & e = errors.at (c);
+					const std::vector<RunningStat> & o = pilots.at (candidates[c] / 2.);
+					for (unsigned int i = 0; i < e.size(); i++)
+						if (2. * (fabs (e[i].mean()) + halfWidth (e[i])) > std::max (relTol * fabs (o[i].mean()), absTol))
+							return false;
+					return !e.empty();
+				}
+				unsigned long int modelRuns () const {return runs;};
+
+				// dt, then error +- half width of each observable
+				void print (std::ostream * stream) const
+				{
+					for (unsigned int c = 0; c < errors.size(); c++)
+					{
+						*stream << candidates[c];
+						for (unsigned int i = 0; i < errors[c].size(); i++)
+							*stream << "    " << error (c, i) << " +- " << errorHalfWidth (c, i);
+						*stream << (accepted (c) ? "    accepted" : "") << std::endl;
+					}
+				}
+
+			private:
+				Model & model;
+				const int replicas;
+				const uint64_t seed0;
+				double relTol, absTol;
+				unsigned long int runs;
+
+				std::vector<double> candidates;
+				std::map<double, std::vector<RunningStat> > pilots; // by time step
+				std::map<double, std::vector<std::vector<double> > > samples; // replicas by time step
+				std::vector<std::vector<RunningStat> > errors; // O (dt) - O (dt/2), by candidate
+
+				const std::vector<std::vector<double> > & pilot (double dt)
+				{
+					std::vector<std::vector<double> > & s = samples[dt];
+					if (s.empty())
+					{
+						std::vector<RunningStat> & o = pilots[dt];
+						for (int r = 0; r < replicas; r++)
+						{
+							Random::seed (seed0 + r);
+							s.push_back (model (dt));
+							runs++;
+							if (o.size() < s.back().size())
+								o.resize (s.back().size());
+							for (unsigned int i = 0; i < s.back().size(); i++)
+								o[i].push (s.back()[i]);
+						}
+					}
+					return s;
+				}
+
+				std::vector<RunningStat> estimate (double dt)
+				{
+					const std::vector<std::vector<double> > & a = pilot (dt);
+					const std::vector<std::vector<double> > & b = pilot (dt / 2.);
+					std::vector<RunningStat> d (std::min (a[0].size(), b[0].size()));
+					for (int r = 0; r < replicas; r++)
+						for (unsigned int i = 0; i < d.size(); i++)
+							d[i].push (a[r][i] - b[r][i]);
+					return d;
+				}
+		};
+
+}; // namespace PDL
+
+#endif
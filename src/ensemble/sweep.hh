@@ -0,0 +1,283 @@
+// sweep.hh
+// parameter sweeps with common random numbers and a result cache
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_ENSEMBLE_SWEEP_HH
+# define PDLIB_ENSEMBLE_SWEEP_HH
+
+#include <vector>
+#include <map>
+#include <string>
+#include <stdexcept>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <cerrno>
+#include <algorithm>
+#include <stdint.h>
+
+#include <sys/stat.h>
+
+#include <pdlib/version.hh>
+#include <pdlib/random.hh>
+#include <pdlib/observables/stat.hh>
+#include <pdlib/observables/convergence.hh>
+
+namespace PDL
+{
+	// A Model is called as model (params) and returns a vector of observables;
+	// it must create its geometry, particles and reactions inside the call.
+	//
+	// Replica r of every parameter point runs with the seed seed0 + r, so
+	// neighbouring points see the same random numbers (common random numbers)
+	// and differences between them are resolved with fewer replicas. The
+	// observables of every replica are kept and enter the statistics of
+	// their point once.
+	//
+	// With a cache directory every completed replica is stored in a file
+	// named after a hash of the model name, parameters, seed and PDL version,
+	// so extending a grid (or the number of replicas) only runs new replicas.
+	//
+	// With a precision target the number of replicas becomes a maximum: a
+	// point stops as soon as the confidence intervals of its observables are
+	// within the tolerance (after a minimum number of replicas).
+	template<class Model>
+		class Sweep
+		{
+			public:
+				Sweep (const std::string & name, Model & model, int replicas,
+					const std::string & cachedir = "", uint64_t seed0 = 1)
+					: name (name), model (model), replicas (replicas),
+					cachedir (cachedir), seed0 (seed0), hits (0), runs (0),
+					relTol (0.), absTol (0.), minReplicas (replicas)
+				{
+					struct stat st;
+					if (!cachedir.empty() && mkdir (cachedir.c_str(), 0755) != 0
+						&& (errno != EEXIST || stat (cachedir.c_str(), &st) != 0 || !S_ISDIR (st.st_mode)))
+						throw std::runtime_error ("Sweep: cannot create cache directory " + cachedir
+							+ ": " + strerror (errno));
+				};
+
+				int addPoint (const std::vector<double> & params)
+				{
+					points.push_back (params);
+					results.push_back (std::vector<RunningStat> ());
+					values.push_back (std::map<int, std::vector<double> > ());
+					return points.size() - 1;
+				}
+
+				// cartesian product of the values of each parameter
+				void addGrid (const std::vector<std::vector<double> > & axes)
+				{
+					std::vector<int> k (axes.size(), 0);
+					while (true)
+					{
+						std::vector<double> p (axes.size());
+						for (unsigned int i = 0; i < axes.size(); i++)
+							p[i] = axes[i][k[i]];
+						addPoint (p);
+
+						unsigned int i = 0;
+						while (i < axes.size() && ++k[i] == static_cast<int> (axes[i].size()))
+							k[i++] = 0;
+						if (i == axes.size())
+							break;
+					}
+				}
+
+				// halfWidth <= max (relTol * |mean|, absTol) for all observables
+				void setPrecision (double rel, double abs = 0., int nmin = 5)
+				{
+					relTol = rel;
+					absTol = abs;
+					minReplicas = nmin;
+				}
+
+				void run ()
+				{
+					for (unsigned int p = 0; p < points.size(); p++)
+						for (int r = 0; static_cast<int> (count (p)) < replicas
+							&& (static_cast<int> (count (p)) < minReplicas || !precise (p)); r++)
+							replica (p, r);
+				}
+
+				// the precision target is met at point p
+				bool precise (int p) const
+				{
+					const std::vector<RunningStat> & s = results.at (p);
+					if (s.empty() || (relTol <= 0. && absTol <= 0.))
+						return false;
+					for (unsigned int i = 0; i < s.size(); i++)
+						if (halfWidth (s[i]) > std::max (relTol * fabs (s[i].mean()), absTol))
+							return false;
+					return true;
+				}
+
+				// observables of replica r of point p: run (or read from the
+				// cache) the first time and added to the statistics, then kept
+				std::vector<double> replica (int p, int r)
+				{
+					std::map<int, std::vector<double> > & done = values.at (p);
+					std::map<int, std::vector<double> >::const_iterator v = done.find (r);
+					if (v != done.end())
+						return v->second;
+
+					std::vector<double> x = evaluate (points[p], seed0 + r);
+					std::vector<RunningStat> & s = results[p];
+					if (s.size() < x.size())
+						s.resize (x.size());
+					for (unsigned int i = 0; i < x.size(); i++)
+						s[i].push (x[i]);
+					done[r] = x;
+					return x;
+				}
+
+				int size () const {return points.size();};
+				int getReplicas () const {return replicas;};
+				void setReplicas (int n) {replicas = n;};
+				const std::vector<double> & point (int p) const {return points.at (p);};
+				const std::vector<RunningStat> & result (int p) const {return results.at (p);};
+				unsigned long int count (int p) const
+				{
+					return values.at (p).size();
+				}
+
+				// replicas read from the cache and actually run
+				unsigned long int cacheHits () const {return hits;};
+				unsigned long int modelRuns () const {return runs;};
+
+				void print (std::ostream * stream) const
+				{
+					for (unsigned int p = 0; p < points.size(); p++)
+					{
+						for (unsigned int i = 0; i < points[p].size(); i++)
+							*stream << points[p][i] << " ";
+						for (unsigned int i = 0; i < results[p].size(); i++)
+							*stream << "    " << results[p][i].mean() << " "
+								<< sqrt (results[p][i].variance() / results[p][i].count());
+						*stream << std::endl;
+					}
+				}
+
+			private:
+				const std::string name;
+				Model & model;
+				int replicas;
+				const std::string cachedir;
+				const uint64_t seed0;
+
+				std::vector<std::vector<double> > points;
+				std::vector<std::vector<RunningStat> > results;
+				std::vector<std::map<int, std::vector<double> > > values; // by point and replica
+				unsigned long int hits, runs;
+				double relTol, absTol;
+				int minReplicas;
+
+				// run the model (or read the cache) with the seed
+				std::vector<double> evaluate (const std::vector<double> & params, uint64_t seed)
+				{
+					std::vector<double> x;
+					std::string file = cacheFile (params, seed);
+					if (!file.empty() && read (file, x))
+						hits++;
+					else
+					{
+						Random::seed (seed);
+						x = model (params);
+						runs++;
+						if (x.empty())
+							throw std::runtime_error ("Sweep: " + name + " returned no observables");
+						if (!file.empty())
+							write (file, x);
+					}
+					return x;
+				}
+
+				// FNV-1a
+				static void hash (uint64_t & h, const void * data, size_t n)
+				{
+					const unsigned char * c = static_cast<const unsigned char*> (data);
+					for (size_t i = 0; i < n; i++)
+					{
+						h ^= c[i];
+						h *= 0x100000001b3ULL;
+					}
+				}
+
+				std::string cacheFile (const std::vector<double> & params, uint64_t seed) const
+				{
+					if (cachedir.empty())
+						return "";
+
+					uint64_t h = 0xcbf29ce484222325ULL;
+					hash (h, name.c_str(), name.size());
+					for (unsigned int i = 0; i < params.size(); i++)
+						hash (h, &params[i], sizeof (double));
+					hash (h, &seed, sizeof (seed));
+					hash (h, PDL_VERSION, strlen (PDL_VERSION));
+
+					std::ostringstream s;
+					s << cachedir << "/" << std::hex << std::setw (16) << std::setfill ('0') << h << ".dat";
+					return s.str();
+				}
+
+				static bool read (const std::string & file, std::vector<double> & v)
+				{
+					std::ifstream stream (file);
+					if (!stream)
+						return false;
+					double x;
+					while (stream >> x)
+						v.push_back (x);
+					return !v.empty();
+				}
+
+				// the cache only saves work: a replica which cannot be stored
+				// is reported and run again next time
+				static void write (const std::string & file, const std::vector<double> & v)
+				{
+					// write and rename, so an interrupted run leaves no partial entry
+					std::string tmp = file + ".tmp";
+					bool ok;
+					{
+						std::ofstream stream (tmp);
+						stream << std::setprecision (17);
+						for (unsigned int i = 0; i < v.size(); i++)
+							stream << v[i] << std::endl;
+						stream.close ();
+						ok = !stream.fail ();
+					}
+					if (ok && rename (tmp.c_str(), file.c_str()) == 0)
+						return;
+					std::cerr << "Sweep: cannot write cache entry " << file << ": "
+						<< strerror (errno) << std::endl;
+					remove (tmp.c_str());
+				}
+		};
+
+}; // namespace PDL
+
+#endif
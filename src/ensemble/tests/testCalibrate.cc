@@ -0,0 +1,121 @@
+/* testCalibrate.cc  2015-08-21 the time step from pilot runs
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <stdexcept>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/ensemble/calibrate.hh>
+
+typedef PDL::GeometryBox<double, 2> Box;
+typedef PDL::SpeciesFactory<Box> Factory;
+typedef PDL::CompiledNetwork<Box> Rxn;
+
+const double km = 0.5, kdeg = 0.05;
+
+PDL::ReactionNetwork network (int & gene, int & mrna)
+{
+	PDL::ReactionNetwork net;
+	gene = net.addSpecies ("Gene", 0.);
+	mrna = net.addSpecies ("mRNA", 0.);
+	net.produce (gene, mrna, km);
+	net.decay (mrna, kdeg);
+	return net;
+}
+
+// genes making (immobile) mRNA, started at the stationary mean; returns
+// the mean mRNA number per gene over the second half of the run
+class Pilot
+{
+	public:
+		std::vector<double> operator() (double dt)
+		{
+			Box::Space x0 (0.), H (2.);
+			Box b (x0, H);
+			int gene, mrna;
+			PDL::ReactionNetwork net = network (gene, mrna);
+			Factory F (net, dt);
+			PDL::System<Box, Factory, Rxn> system (b, F);
+			system.addReaction (Rxn (net, F, b));
+			int ngenes = 200;
+			for (int i = 0; i < ngenes; i++)
+			{
+				system.addParticle (x0, gene);
+				for (int j = 0; j < km / kdeg; j++)
+					system.addParticle (x0, mrna);
+			}
+
+			double T = 200., m = 0.;
+			int n = 0;
+			for (int k = 1; k * dt < T + 0.5 * dt; k++)
+			{
+				system.evolve (dt);
+				if (k * dt >= T / 2. && fmod (k * dt + 0.5 * dt, 1.) < dt)
+				{
+					m += system.getNParticles (mrna);
+					n++;
+				}
+			}
+			return std::vector<double> (1, m / n / ngenes);
+		}
+};
+
+int main (int argc, char ** argv)
+{
+	// fixed steps realise the stationary mean (1 - exp (- km dt)) / (1 - exp (- kdeg dt))
+	double tol = 0.03;
+	int gene, mrna;
+	PDL::ReactionNetwork net = network (gene, mrna);
+	std::cerr << "saturation: rates within " << tol << " up to dt = "
+		<< PDL::saturationTimeStep (net, tol) << std::endl;
+
+	Pilot model;
+	PDL::TimeStepCalibration<Pilot> calibration (model, 16);
+	calibration.setTolerance (tol);
+	calibration.setRange (0.4, 0.0125);
+	double dt = calibration.run ();
+	calibration.print (&std::cerr);
+
+	double exact = km / kdeg;
+	for (int c = 0; c < calibration.nTried (); c++)
+	{
+		double h = calibration.candidate (c);
+		double m = (1. - exp (- km * h)) / (1. - exp (- kdeg * h));
+		std::cerr << "dt = " << h << ": mean " << calibration.mean (h, 0) << " (" << m
+			<< "), true error " << m - exact << std::endl;
+	}
+	double m = (1. - exp (- km * dt)) / (1. - exp (- kdeg * dt));
+	std::cerr << "chosen dt = " << dt << " after " << calibration.modelRuns () << " pilot runs, relative error "
+		<< (m - exact) / exact << " (" << tol << ")" << std::endl;
+
+	// a single replica gives no half width
+	try
+	{
+		PDL::TimeStepCalibration<Pilot> single (model, 1);
+		std::cerr << "one replica: accepted" << std::endl;
+	}
+	catch (std::invalid_argument & e)
+	{
+		std::cerr << "one replica: " << e.what () << std::endl;
+	}
+
+	return 1;
+}
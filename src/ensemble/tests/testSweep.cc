@@ -0,0 +1,143 @@
+/* testSweep.cc  2015-08-03 sweep over the mRNA production rate
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <string>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/ensemble/sweep.hh>
+
+typedef PDL::GeometryBox<double, 2> Box;
+typedef PDL::SpeciesFactory<Box> Factory;
+typedef PDL::CompiledNetwork<Box> Rxn;
+
+// params: kon, koff, km; returns the number of mRNA after an hour
+class MinGen
+{
+	public:
+		std::vector<double> operator() (const std::vector<double> & k)
+		{
+			Box::Space x0 (0.), H (2.);
+			Box b (x0, H);
+			double dt = 1.;
+
+			PDL::ReactionNetwork net;
+			int off = net.addSpecies ("GeneOff", 0.);
+			int on = net.addSpecies ("GeneOn", 0.);
+			int mrna = net.addSpecies ("mRNA", 0.01);
+			net.convert (off, on, k[0]);
+			net.convert (on, off, k[1]);
+			net.produce (on, mrna, k[2]);
+			net.decay (mrna, 0.001);
+
+			Factory F (net, dt);
+			PDL::System<Box, Factory, Rxn> system (b, F);
+			system.addReaction (Rxn (net, F, b));
+			system.addParticle (x0, off);
+			for (int i = 0; i < 3600; i++)
+				system.evolve (dt);
+
+			return std::vector<double> (1, system.getNParticles (mrna));
+		}
+};
+
+int main (int argc, char ** argv) 
+{
+	MinGen model;
+	std::vector<std::vector<double> > axes (3);
+	axes[0].push_back (0.01);
+	axes[1].push_back (0.01);
+	axes[2].push_back (0.1);
+	axes[2].push_back (0.11);
+
+	// difference between the two points, common against independent random numbers
+	PDL::Sweep<MinGen> crn ("mingen", model, 20);
+	PDL::Sweep<MinGen> indep ("mingen", model, 20, "", 1000);
+	crn.addGrid (axes);
+	std::vector<double> k0 (3);
+	k0[0] = axes[0][0];
+	k0[1] = axes[1][0];
+	k0[2] = axes[2][0];
+	indep.addPoint (k0);
+	crn.run ();
+
+	// replicas of crn are kept from run (), those of indep are run here
+	PDL::RunningStat dcrn, dindep;
+	for (int r = 0; r < 20; r++)
+	{
+		double m1 = crn.replica (1, r)[0];
+		double m0 = crn.replica (0, r)[0];
+		double mi = indep.replica (0, r)[0];
+		dcrn.push (m1 - m0);
+		dindep.push (m1 - mi);
+	}
+	std::cerr << "crn: " << crn.count (0) << " and " << crn.count (1) << " replicas, "
+		<< crn.modelRuns () << " model runs" << std::endl;
+	std::cerr << "variance of the difference, common random numbers: " << dcrn.variance () 
+		<< ", independent: " << dindep.variance () << std::endl;
+
+	// second pass is read from the cache
+	PDL::Sweep<MinGen> cached ("mingen", model, 10, "sweep-cache");
+	cached.addGrid (axes);
+	cached.run ();
+	PDL::Sweep<MinGen> again ("mingen", model, 10, "sweep-cache");
+	again.addGrid (axes);
+	again.run ();
+	std::cerr << "model runs: " << again.modelRuns () << ", cache hits: " << again.cacheHits () << std::endl;
+	again.print (&std::cout);
+
+	// replicas until the mean is known to 10%, at most 200
+	PDL::Sweep<MinGen> adaptive ("mingen", model, 200, "sweep-cache");
+	adaptive.setPrecision (0.1);
+	adaptive.addGrid (axes);
+	adaptive.run ();
+	for (int p = 0; p < adaptive.size (); p++)
+		std::cerr << "point " << p << ": " << adaptive.count (p) << " replicas, " 
+			<< adaptive.result(p)[0].mean () << " +- " << PDL::halfWidth (adaptive.result(p)[0]) << std::endl;
+
+	// a cache directory which cannot be created
+	try
+	{
+		PDL::Sweep<MinGen> bad ("mingen", model, 1, "sweep-cache/nonexistent/cache");
+		std::cerr << "unusable cache directory accepted" << std::endl;
+	}
+	catch (std::runtime_error & e)
+	{
+		std::cerr << "unusable cache directory refused: " << e.what () << std::endl;
+	}
+
+	// leave no cache behind
+	DIR * dir = opendir ("sweep-cache");
+	if (dir != nullptr)
+	{
+		struct dirent * e;
+		while ((e = readdir (dir)) != nullptr)
+			if (e->d_name[0] != '.')
+				unlink ((std::string ("sweep-cache/") + e->d_name).c_str());
+		closedir (dir);
+		rmdir ("sweep-cache");
+	}
+
+	return 1;
+}
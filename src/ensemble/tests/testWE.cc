@@ -0,0 +1,96 @@
+/* testWE.cc  2015-08-10 weighted ensemble for the tail of the mRNA distribution
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/ensemble/we.hh>
+
+typedef PDL::GeometryBox<double, 2> Box;
+typedef PDL::SpeciesFactory<Box> Factory;
+typedef PDL::CompiledNetwork<Box> Rxn;
+typedef PDL::System<Box, Factory, Rxn> Sys;
+
+int main (int argc, char ** argv) 
+{
+	PDL::Random::seed (1);
+
+	Box::Space x0 (0.), H (2.);
+	Box b (x0, H);
+	double dt = 0.05;
+
+	// constitutive gene: birth rate km, death rate kdeg n, Poisson (km / kdeg)
+	double km = 1., kdeg = 0.1;
+	PDL::ReactionNetwork net;
+	int gene = net.addSpecies ("Gene", 0.);
+	int mrna = net.addSpecies ("mRNA", 0.);
+	net.produce (gene, mrna, km);
+	net.decay (mrna, kdeg);
+
+	Factory F (net, dt);
+	Sys system (b, F);
+	system.addReaction (Rxn (net, F, b));
+	system.addParticle (x0, gene);
+
+	std::vector<double> edges;
+	for (int n = 1; n <= 30; n++)
+		edges.push_back (n);
+	auto q = [mrna] (const Sys & s) {return static_cast<double> (s.getNParticles (mrna));};
+
+	// exact: Poisson tail and mean first passage time from 0 to N, with
+	// the rates the time stepping actually realises, (1 - exp (- k dt)) / dt
+	int N = 25;
+	km = (1. - exp (- km * dt)) / dt;
+	kdeg = (1. - exp (- kdeg * dt)) / dt;
+	double lambda = km / kdeg;
+	std::vector<double> pi (N + 1);
+	pi[0] = exp (- lambda);
+	for (int n = 1; n <= N; n++)
+		pi[n] = pi[n-1] * lambda / n;
+	double tail = 1., T = 0., cum = 0.;
+	for (int n = 0; n < N; n++)
+	{
+		tail -= pi[n];
+		cum += pi[n];
+		T += cum / (km * pi[n]);
+	}
+
+	// stationary distribution
+	PDL::WeightedEnsemble<Sys> we (system, q, edges, 4, 1., dt);
+	we.run (100);
+	we.resetStatistics ();
+	we.run (2000);
+	std::cerr << "P(n >= " << N << "): " << we.tail (N) << " (" << tail << ") with "
+		<< we.nWalkers () << " walkers" << std::endl;
+
+	// rate of reaching N from an empty cell, given as a temporary
+	PDL::WeightedEnsemble<Sys> rate (Sys (system), q, edges, 4, 1., dt);
+	rate.setTarget (N);
+	rate.run (100);
+	rate.resetStatistics ();
+	rate.run (2000);
+	std::cerr << "rate to n = " << N << ": " << rate.flux () << " +- " << rate.fluxError () 
+		<< " (" << 1. / T << ")" << std::endl;
+
+	we.print (&std::cout);
+
+	return 1;
+}
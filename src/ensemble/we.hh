@@ -0,0 +1,251 @@
+// we.hh
+// weighted ensemble sampling of rare events
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_ENSEMBLE_WE_HH
+# define PDLIB_ENSEMBLE_WE_HH
+
+#include <vector>
+#include <ostream>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <limits>
+#include <cmath>
+#include <stdint.h>
+
+#include <pdlib/random.hh>
+#include <pdlib/observables/stat.hh>
+
+namespace PDL
+{
+	// Weighted ensemble (Huber and Kim): a set of weighted copies (walkers)
+	// of a System is evolved for a time tau, then walkers are resampled in
+	// bins of a progress coordinate q (system): in every occupied bin the
+	// heaviest walkers are split and the lightest merged until the bin holds
+	// perBin walkers. The total weight stays 1 and the resampling is
+	// unbiased, so bins which brute force hardly ever visits are sampled as
+	// often as the common ones, with small weights.
+	//
+	// Bin probabilities are averaged over iterations. With a target (walkers
+	// reaching q >= qtarget are restarted from the initial state, keeping
+	// their weight) the weight arriving per unit time is the steady state
+	// rate of reaching the target, i.e., 1 / mean first passage time.
+	//
+	// S must be copyable (deep copy) and have reseed (seed) and evolve (dt),
+	// as System does. The ensemble keeps its own copy of the initial state.
+	template<class S>
+		class WeightedEnsemble
+		{
+			public:
+				typedef std::function<double (const S &)> Coordinate;
+
+				// bin i is [edges[i-1], edges[i]), with two open bins at the ends
+				WeightedEnsemble (const S & initial, Coordinate q, const std::vector<double> & edges,
+					int perBin, double tau, double dt)
+					: initial (initial), q (q), edges (edges), perBin (perBin),
+					tau (tau), dt (dt), target (false), qtarget (0.),
+					iterations (0), engine (Random::next ()),
+					uniform (0., 1.), P (edges.size() + 1)
+				{
+					std::sort (this->edges.begin(), this->edges.end());
+					for (int i = 0; i < perBin; i++)
+						walkers.push_back (Walker (clone (initial), 1. / perBin));
+				};
+
+				~WeightedEnsemble ()
+				{
+					for (unsigned int i = 0; i < walkers.size(); i++)
+						delete walkers[i].s;
+				}
+
+				// restart walkers reaching q >= qt from the initial state
+				void setTarget (double qt)
+				{
+					target = true;
+					qtarget = qt;
+				}
+
+				void run (int n)
+				{
+					for (int k = 0; k < n; k++)
+						iterate ();
+				}
+
+				void iterate ()
+				{
+					int steps = static_cast<int> (tau / dt + 0.5);
+					double flux = 0.;
+					for (unsigned int i = 0; i < walkers.size(); i++)
+					{
+						Walker & w = walkers[i];
+						for (int j = 0; j < steps; j++)
+						{
+							w.s->evolve (dt);
+							if (target && q (*w.s) >= qtarget)
+							{
+								flux += w.w;
+								delete w.s;
+								w.s = clone (initial);
+							}
+						}
+					}
+
+					resample ();
+
+					std::vector<double> p (nBins (), 0.);
+					for (unsigned int i = 0; i < walkers.size(); i++)
+						p[walkers[i].bin] += walkers[i].w;
+					for (int b = 0; b < nBins (); b++)
+						P[b].push (p[b]);
+					rate.push (flux / (steps * dt));
+					iterations++;
+				}
+
+				// forget the statistics so far (e.g., the relaxation to steady state)
+				void resetStatistics ()
+				{
+					for (int b = 0; b < nBins (); b++)
+						P[b].reset ();
+					rate.reset ();
+				}
+
+				int nBins () const {return edges.size() + 1;};
+				int bin (double x) const
+				{
+					return std::upper_bound (edges.begin(), edges.end(), x) - edges.begin();
+				}
+
+				// average probability of bin b, and of q >= x for a bin edge x
+				double probability (int b) const {return P.at(b).mean();};
+				double tail (double x) const
+				{
+					double p = 0.;
+					for (int b = bin (x); b < nBins (); b++)
+						p += probability (b);
+					return p;
+				}
+
+				// weight reaching the target per unit time, its standard error
+				// (iterations are correlated, so this is a lower bound)
+				double flux () const {return rate.mean();};
+				double fluxError () const
+				{
+					return (rate.count() > 1) ? sqrt (rate.variance() / (rate.count() - 1)) : 0.;
+				}
+
+				int nWalkers () const {return walkers.size();};
+				unsigned long int nIterations () const {return iterations;};
+
+				void print (std::ostream * stream) const
+				{
+					for (int b = 0; b < nBins (); b++)
+					{
+						double lo = (b > 0) ? edges[b-1] : -std::numeric_limits<double>::infinity();
+						*stream << lo << "     " << probability (b) << " "
+							<< sqrt (P[b].variance() / std::max<unsigned long int> (P[b].count(), 1)) << std::endl;
+					}
+				}
+
+			private:
+				struct Walker
+				{
+					Walker (S * s, double w) : s (s), w (w), bin (0) {};
+					S * s;
+					double w;
+					int bin;
+				};
+
+				const S initial;
+				Coordinate q;
+				std::vector<double> edges;
+				const int perBin;
+				const double tau, dt;
+				bool target;
+				double qtarget;
+
+				std::vector<Walker> walkers;
+				unsigned long int iterations;
+				std::mt19937 engine;
+				std::uniform_real_distribution<double> uniform;
+
+				std::vector<RunningStat> P; // bin probabilities
+				RunningStat rate;
+
+				S * clone (const S & s)
+				{
+					S * c = new S (s);
+					c->reseed (Random::next ());
+					return c;
+				}
+
+				void resample ()
+				{
+					std::vector<std::vector<Walker> > bins (nBins ());
+					for (unsigned int i = 0; i < walkers.size(); i++)
+					{
+						Walker & w = walkers[i];
+						w.bin = bin (q (*w.s));
+						bins[w.bin].push_back (w);
+					}
+
+					walkers.clear ();
+					for (int b = 0; b < nBins (); b++)
+					{
+						std::vector<Walker> & v = bins[b];
+						if (v.empty())
+							continue;
+
+						// merge the two lightest, the survivor chosen by weight
+						while (static_cast<int> (v.size()) > perBin)
+						{
+							std::sort (v.begin(), v.end(), heavier);
+							Walker a = v.back (); v.pop_back ();
+							Walker & c = v.back ();
+							double w = a.w + c.w;
+							if (uniform (engine) * w < a.w)
+								std::swap (a.s, c.s);
+							delete a.s;
+							c.w = w;
+						}
+
+						// split the heaviest in two
+						while (static_cast<int> (v.size()) < perBin)
+						{
+							std::sort (v.begin(), v.end(), heavier);
+							v[0].w *= 0.5;
+							v.push_back (Walker (clone (*v[0].s), v[0].w));
+							v.back().bin = b;
+						}
+
+						walkers.insert (walkers.end(), v.begin(), v.end());
+					}
+				}
+
+				static bool heavier (const Walker & a, const Walker & b) {return a.w > b.w;};
+
+				WeightedEnsemble (const WeightedEnsemble &);
+		};
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,106 @@
+// boundary.hh
+// boundary conditions for geometries
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_GEO_BOUNDARY_HH
+# define PDLIB_GEO_BOUNDARY_HH
+
+#include <cmath>
+
+namespace PDL
+{
+	// REJECTING: a move leaving the domain is rejected and redrawn (default)
+	// REFLECTING: a move leaving the domain is mirrored back
+	// ABSORBING: a particle touching the boundary is removed
+	// REACTIVE: partially absorbing (Robin) boundary with reactivity kappa
+	typedef enum {
+		PDL_BOUNDARY_REJECTING,
+		PDL_BOUNDARY_REFLECTING,
+		PDL_BOUNDARY_ABSORBING,
+		PDL_BOUNDARY_REACTIVE
+	} BoundaryType;
+
+	class BoundaryCondition
+	{
+		public:
+			BoundaryCondition () : bc (PDL_BOUNDARY_REJECTING), kappa (0) {};
+
+			void setBoundary (BoundaryType type, double kappa = 0.)
+			{
+				bc = type;
+				this->kappa = kappa;
+			}
+
+			BoundaryType boundary () const {return bc;};
+			double reactivity () const {return kappa;};
+
+			// probability that a particle which hit the boundary (see
+			// contactProbability) is absorbed, for the reactive boundary
+			// kappa sqrt(pi dt / D) (Erban & Chapman, Phys Biol 4, 16, 2007)
+			double absorptionProbability (double D, double dt) const
+			{
+				switch (bc)
+				{
+					case PDL_BOUNDARY_ABSORBING:
+						return 1.;
+					case PDL_BOUNDARY_REACTIVE:
+					{
+						double p = kappa * sqrt (M_PI * dt / D);
+						return (p < 1.) ? p : 1.;
+					}
+					default:
+						return 0.;
+				}
+			}
+
+			// probability that a Brownian bridge from distance d0 to distance d1
+			// (both inside) touches a flat boundary in between,
+			// exp (-2 d0 d1 / sigma^2) with sigma^2 = 2 D dt
+			static double bridgeProbability (double d0, double d1, double D, double dt)
+			{
+				if (d0 <= 0. || d1 <= 0.)
+					return 1.;
+				return exp (- d0 * d1 / (D * dt));
+			}
+
+		private:
+			BoundaryType bc;
+			double kappa;
+	};
+
+	// Probability that a step from x to xnew hits the boundary. An absorbing
+	// boundary catches every contact of the Brownian bridge. The reactive
+	// coefficient is calibrated for steps ending outside (which are then
+	// reflected), so only those count: bridge contacts are about twice as
+	// frequent and would absorb too much.
+	template<class Geometry>
+		double contactProbability (const Geometry & g, const typename Geometry::Space & x,
+			const typename Geometry::Space & xnew, double D, double dt)
+		{
+			if (g.boundary() == PDL_BOUNDARY_REACTIVE)
+				return g.inside (xnew) ? 0. : 1.;
+			return g.crossingProbability (x, xnew, D, dt);
+		}
+
+}; // namespace PDL
+
+#endif
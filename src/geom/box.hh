@@ -24,12 +24,18 @@
 #ifndef PDLIB_GEO_BOX_HH
 # define PDLIB_GEO_BOX_HH
 
+#include <random>
+
 #include <dune/common/fvector.hh>
 
+#include <pdlib/random.hh>
+#include <pdlib/geom/boundary.hh>
+#include <pdlib/instances.hh>
+
 namespace PDL 
 {
 	template<typename ctype, int dim>
-		class GeometryBox
+		class GeometryBox : public BoundaryCondition
 		{
 			public:
 				enum {dimension = dim};
@@ -48,20 +54,33 @@ namespace PDL
 					std::cerr << "left corner: " << xl << std::endl;
 					std::cerr << "right corner: " << xr << std::endl;
 #endif
-					srand(time(NULL)); // Seed the time
+					Random::init (); // seed rand() unless seeded explicitly
 
 				};
 
+				// computed in double and clamped: rounded to float a point
+				// could land outside the box
 				Space randomPoint () 
 				{
 					Space x;
 					for (int i = 0; i < dim; i++)
-					{
-						x[i] = xl[i] + static_cast <double> (rand()) /( static_cast <double> (RAND_MAX/(H[i])));
-					}
+						x[i] = clamp (xl[i] + H[i] * (rand() / static_cast <double> (RAND_MAX)), i);
 					return x;
 				}
 
+				// thread-safe version drawing from the caller's random engine
+				template<class RNG>
+					Space randomPoint (RNG & engine) const
+					{
+						Space x;
+						for (int i = 0; i < dim; i++)
+						{
+							std::uniform_real_distribution<double> u (xl[i], xr[i]);
+							x[i] = clamp (u (engine), i);
+						}
+						return x;
+					}
+
 				bool inside (const Space & x) const
 				{
 #ifdef DEBUG
@@ -86,9 +105,11 @@ namespace PDL
 						if (n[i] != 0.)
 						{
 							double tl = norm * (xl[i] - x[i])  / n[i];
+#ifdef DEBUG
 							std::cerr << "i=" << i << " t=" << t
 								<< " tl=" << tl 
 								<< " xl=" << xl[i] << " x=" << x[i] << std::endl;
+#endif
 							if (tl > 0.) 
 							{
 								if ((t == 0.0) || (tl < t))
@@ -96,9 +117,11 @@ namespace PDL
 							}
 
 							double tr = norm * (xr[i] - x[i])  / n[i];
+#ifdef DEBUG
 							std::cerr << "i=" << i << " t=" << t
 								<< " tr=" << tr << " xr=" 
 								<< xr[i] << " x=" << x[i] << std::endl;
+#endif
 							if (tr > 0.) 
 							{
 								if ((t == 0.0) || (tr < t))
@@ -110,6 +133,45 @@ namespace PDL
 					return t;
 				};
 
+				// probability that a Brownian path with diffusion coefficient D
+				// went from x to xnew in time dt touching the boundary;
+				// each face is treated as an independent flat boundary
+				double crossingProbability (const Space & x, const Space & xnew, double D, double dt) const
+				{
+					if (!inside (xnew))
+						return 1.;
+
+					double q = 1.; // probability not to touch any face
+					Space n (0.);
+					for (int i = 0; i < dimension; i++)
+					{
+						for (int side = -1; side <= 1; side += 2)
+						{
+							n[i] = side;
+							q *= 1. - bridgeProbability (toBoundary (x, n), toBoundary (xnew, n), D, dt);
+						}
+						n[i] = 0.;
+					}
+					return 1. - q;
+				}
+
+				// mirror a point outside back into the box
+				void reflect (Space & x) const
+				{
+					for (int i = 0; i < dimension; i++)
+						while ( (x[i] > xr[i]) || (x[i] < xl[i]) )
+						{
+							if (x[i] > xr[i])
+								x[i] = 2. * xr[i] - x[i];
+							if (x[i] < xl[i])
+								x[i] = 2. * xl[i] - x[i];
+						}
+				}
+
+				// bounding box corners
+				const Space & lower () const {return xl;};
+				const Space & upper () const {return xr;};
+
 			private:
 
 				const Space & x0;
@@ -117,8 +179,20 @@ namespace PDL
 
 				Space xl;
 				Space xr;
+
+				ctype clamp (double y, int i) const
+				{
+					ctype c = static_cast <ctype> (y);
+					return (c < xl[i]) ? xl[i] : ((c > xr[i]) ? xr[i] : c);
+				}
 		};
 
+#ifdef PDL_EXTERN_TEMPLATES
+#define PDL_EXTERN(ctype, dim) extern template class GeometryBox<ctype, dim>;
+	PDL_INSTANCES (PDL_EXTERN)
+#undef PDL_EXTERN
+#endif
+
 }; // namespace PDL
 
 #endif
@@ -0,0 +1,310 @@
+// cells.hh
+// cell list spatial index for particles in a geometry
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_GEO_CELLS_HH
+# define PDLIB_GEO_CELLS_HH
+
+#include <vector>
+#include <unordered_map>
+#include <queue>
+#include <utility>
+#include <cmath>
+
+#include <dune/common/fvector.hh>
+
+namespace PDL
+{
+	// Regular grid of cells over the bounding box of a geometry; every cell
+	// keeps the particles (and their positions) inside it. Insertion, removal
+	// and moves cost O(1), region queries visit only the cells overlapping
+	// the region, and k nearest neighbours are searched in growing shells
+	// of cells around the query point.
+	template<class Geometry, class Particle>
+		class CellList
+		{
+			public:
+				typedef typename Geometry::Space Space;
+				enum {dimension = Geometry::dimension};
+
+				CellList (const Geometry & g, double h)
+					: xl (g.lower()), h (h), size (0)
+				{
+					int total = 1;
+					for (int i = 0; i < dimension; i++)
+					{
+						n[i] = static_cast<int> (ceil ((g.upper()[i] - xl[i]) / h));
+						if (n[i] < 1) n[i] = 1;
+						total *= n[i];
+					}
+					cells.resize (total);
+				};
+
+				void insert (const Particle * p);
+
+				void remove (const Particle * p);
+
+				// the particle has moved
+				void update (const Particle * p);
+
+				int count () const {return size;};
+				double cellSize () const {return h;};
+
+				// call f (p) for all particles in the box [lo, hi]
+				template<class F>
+					void forEachInBox (const Space & lo, const Space & hi, F f) const
+					{
+						Index a = index (lo), b = index (hi);
+						visit (a, b, [&] (const Entry & e)
+							{
+								for (int i = 0; i < dimension; i++)
+									if (e.x[i] < lo[i] || e.x[i] > hi[i])
+										return;
+								f (e.p);
+							});
+					}
+
+				// call f (p) for all particles within distance r from x
+				template<class F>
+					void forEachInSphere (const Space & x, double r, F f) const
+					{
+						Space lo = x, hi = x;
+						for (int i = 0; i < dimension; i++)
+						{
+							lo[i] -= r;
+							hi[i] += r;
+						}
+						double r2 = r * r;
+						visit (index (lo), index (hi), [&] (const Entry & e)
+							{
+								Space d = e.x;
+								d -= x;
+								if (d.two_norm2() <= r2)
+									f (e.p);
+							});
+					}
+
+				// number of particles (of a type if type >= 0) in a box or a sphere
+				int countInBox (const Space & lo, const Space & hi, int type = -1) const
+				{
+					int k = 0;
+					forEachInBox (lo, hi, [&] (const Particle * p) {if (type < 0 || p->type() == type) k++;});
+					return k;
+				}
+
+				int countInSphere (const Space & x, double r, int type = -1) const
+				{
+					int k = 0;
+					forEachInSphere (x, r, [&] (const Particle * p) {if (type < 0 || p->type() == type) k++;});
+					return k;
+				}
+
+				// k nearest particles (of a type if type >= 0), closest first
+				std::vector<const Particle*> nearest (const Space & x, int k, int type = -1) const
+				{
+					if (k <= 0)
+						return std::vector<const Particle*> ();
+					typedef std::pair<double, const Particle*> Item;
+					std::priority_queue<Item> heap; // largest distance on top
+
+					Index c = index (x);
+					int maxring = 0;
+					for (int i = 0; i < dimension; i++)
+						maxring = std::max (maxring, std::max (c[i], n[i] - 1 - c[i]));
+
+					for (int ring = 0; ring <= maxring; ring++)
+					{
+						Index a, b;
+						for (int i = 0; i < dimension; i++)
+						{
+							a[i] = c[i] - ring;
+							b[i] = c[i] + ring;
+						}
+						visit (a, b, [&] (const Entry & e)
+							{
+								if (type >= 0 && e.p->type() != type)
+									return;
+								Space d = e.x;
+								d -= x;
+								double r2 = d.two_norm2 ();
+								if (static_cast<int> (heap.size()) < k)
+									heap.push (Item (r2, e.p));
+								else if (r2 < heap.top().first)
+								{
+									heap.pop ();
+									heap.push (Item (r2, e.p));
+								}
+							}, c, ring);
+
+						// all particles closer than ring * h have been seen
+						if (static_cast<int> (heap.size()) == k && heap.top().first <= ring * h * ring * h)
+							break;
+					}
+
+					std::vector<const Particle*> result (heap.size());
+					for (int i = heap.size() - 1; i >= 0; i--)
+					{
+						result[i] = heap.top().second;
+						heap.pop ();
+					}
+					return result;
+				}
+
+			private:
+				typedef Dune::FieldVector<int, dimension> Index;
+
+				struct Entry
+				{
+					Space x;
+					const Particle * p;
+				};
+
+				Space xl;
+				const double h;
+				Index n;
+				int size;
+				std::vector<std::vector<Entry> > cells;
+				std::unordered_map<const Particle*, std::pair<int,int> > where; // cell and slot
+
+				Index index (const Space & x) const
+				{
+					Index k;
+					for (int i = 0; i < dimension; i++)
+					{
+						k[i] = static_cast<int> (floor ((x[i] - xl[i]) / h));
+						if (k[i] < 0) k[i] = 0;
+						if (k[i] >= n[i]) k[i] = n[i] - 1;
+					}
+					return k;
+				}
+
+				int cell (const Space & x) const
+				{
+					Index k = index (x);
+					int c = 0;
+					for (int i = dimension - 1; i >= 0; i--)
+						c = c * n[i] + k[i];
+					return c;
+				}
+
+				// swap-remove slot s of cell c
+				void erase (int c, int s)
+				{
+					std::vector<Entry> & v = cells[c];
+					if (s != static_cast<int> (v.size()) - 1)
+					{
+						v[s] = v.back ();
+						where[v[s].p].second = s;
+					}
+					v.pop_back ();
+				}
+
+				// call f (entry) in all cells of the index box [a, b]; with ring >= 0
+				// only in the cells at Chebyshev distance ring from centre
+				template<class F>
+					void visit (Index a, Index b, F f, const Index & centre = Index (0), int ring = -1) const
+					{
+						for (int i = 0; i < dimension; i++)
+						{
+							if (a[i] < 0) a[i] = 0;
+							if (b[i] >= n[i]) b[i] = n[i] - 1;
+							if (a[i] > b[i])
+								return;
+						}
+
+						Index k = a;
+						while (true)
+						{
+							bool shell = (ring < 0);
+							for (int i = 0; i < dimension && !shell; i++)
+								shell = (abs (k[i] - centre[i]) == ring);
+
+							if (shell)
+							{
+								int c = 0;
+								for (int i = dimension - 1; i >= 0; i--)
+									c = c * n[i] + k[i];
+								const std::vector<Entry> & v = cells[c];
+								for (unsigned int j = 0; j < v.size(); j++)
+									f (v[j]);
+							}
+
+							// next cell in the box
+							int i = 0;
+							while (i < dimension && k[i] == b[i])
+							{
+								k[i] = a[i];
+								i++;
+							}
+							if (i == dimension)
+								break;
+							k[i]++;
+						}
+					}
+		};
+
+	template<class Geometry, class Particle>
+	void CellList<Geometry, Particle>::insert (const Particle * p)
+	{
+		Entry e;
+		e.x = p->position ();
+		e.p = p;
+		int c = cell (e.x);
+		where[p] = std::make_pair (c, static_cast<int> (cells[c].size()));
+		cells[c].push_back (e);
+		size++;
+	}
+
+	template<class Geometry, class Particle>
+	void CellList<Geometry, Particle>::remove (const Particle * p)
+	{
+		typename std::unordered_map<const Particle*, std::pair<int,int> >::iterator w = where.find (p);
+		if (w == where.end())
+			return;
+		erase (w->second.first, w->second.second);
+		where.erase (w);
+		size--;
+	}
+
+	template<class Geometry, class Particle>
+	void CellList<Geometry, Particle>::update (const Particle * p)
+	{
+		std::pair<int,int> & w = where.at (p);
+		Space x = p->position ();
+		int c = cell (x);
+		if (c == w.first)
+		{
+			cells[c][w.second].x = x;
+			return;
+		}
+		erase (w.first, w.second);
+		w.first = c;
+		w.second = cells[c].size();
+		Entry e;
+		e.x = x;
+		e.p = p;
+		cells[c].push_back (e);
+	}
+
+}; // namespace PDL
+
+#endif
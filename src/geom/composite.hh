@@ -0,0 +1,352 @@
+// composite.hh
+// multi-compartment geometry of nested boxes and spheres
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_GEO_COMPOSITE_HH
+# define PDLIB_GEO_COMPOSITE_HH
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#include <dune/common/fvector.hh>
+
+#include <pdlib/geom/box.hh>
+
+namespace PDL
+{
+	typedef enum {PDL_COMPARTMENT_BOX, PDL_COMPARTMENT_SPHERE} CompartmentShape;
+
+	// Compartment 0 is the enclosing box (e.g., the cytoplasm); further
+	// compartments (nucleus, organelles) are boxes or spheres nested in a
+	// parent compartment, siblings must not overlap. A point belongs to the
+	// deepest compartment containing it. Each compartment has its own
+	// diffusion coefficient, and the membrane between two compartments has a
+	// permeability P (infinite by default, 0 for a closed membrane).
+	//
+	// Compartment lookup goes through a bounding volume hierarchy.
+	// compartment (x, hint) starts from a cached compartment: it climbs to
+	// the parents until one contains x and then descends through the
+	// children whose bounding boxes contain x, falling back to the hierarchy
+	// only for compartments with many children (e.g., a cytoplasm with
+	// hundreds of organelles).
+	template<typename ctype, int dim>
+		class GeometryComposite : public BoundaryCondition
+		{
+			public:
+				enum {dimension = dim};
+				typedef ctype type;
+				typedef typename Dune::FieldVector<ctype,dim>  Space;
+
+				GeometryComposite (const Space & x0, const Space & H, double D)
+					: x0 (x0), H (H), root (this->x0, this->H), dirty (true)
+				{
+					Compartment c;
+					c.shape = PDL_COMPARTMENT_BOX;
+					c.c = x0;
+					c.h = H;
+					c.h *= 0.5;
+					c.R = 0.;
+					c.parent = -1;
+					c.depth = 0;
+					c.D = D;
+					bounds (c);
+					comp.push_back (c);
+					permeability.assign (1, HUGE_VAL);
+				};
+
+				// root refers to x0 and H, so it is rebuilt on the copies
+				GeometryComposite (const GeometryComposite & g)
+					: BoundaryCondition (g), x0 (g.x0), H (g.H), root (this->x0, this->H),
+					comp (g.comp), permeability (g.permeability), bvh (g.bvh), dirty (g.dirty) {};
+
+				int addBox (const Space & x0, const Space & H, double D, int parent = 0)
+				{
+					Compartment c;
+					c.shape = PDL_COMPARTMENT_BOX;
+					c.c = x0;
+					c.h = H;
+					c.h *= 0.5;
+					c.R = 0.;
+					return add (c, D, parent);
+				}
+
+				int addSphere (const Space & x0, double R, double D, int parent = 0)
+				{
+					Compartment c;
+					c.shape = PDL_COMPARTMENT_SPHERE;
+					c.c = x0;
+					c.h = 0.;
+					c.R = R;
+					return add (c, D, parent);
+				}
+
+				// permeability (length / time) of the membrane from compartment a
+				// to compartment b
+				void setPermeability (int a, int b, double P) {permeability.at (a * size() + b) = P;};
+				double getPermeability (int a, int b) const {return permeability.at (a * size() + b);};
+
+				// probability to accept a move of time step dt from a to b: as
+				// for the reactive boundary, P sqrt (pi dt / D) with D of a, so
+				// that the flux through the membrane does not depend on dt
+				double transferProbability (int a, int b, double dt) const
+				{
+					double P = permeability[a * size() + b];
+					if (P == HUGE_VAL)
+						return 1.;
+					double p = P * sqrt (M_PI * dt / comp[a].D);
+					return (p < 1.) ? p : 1.;
+				}
+
+				double diffusion (int c) const {return comp.at(c).D;};
+				int parent (int c) const {return comp.at(c).parent;};
+				int size () const {return comp.size();};
+
+				// x is inside compartment id (regardless of nested compartments)
+				bool contains (int id, const Space & x) const
+				{
+					const Compartment & c = comp[id];
+					if (c.shape == PDL_COMPARTMENT_SPHERE)
+					{
+						Space d = x;
+						d -= c.c;
+						return d.two_norm2() <= c.R * c.R;
+					}
+					for (int i = 0; i < dimension; i++)
+						if ( (x[i] > c.hi[i]) || (x[i] < c.lo[i]) )
+							return false;
+					return true;
+				}
+
+				// deepest compartment containing x, -1 outside
+				int compartment (const Space & x)
+				{
+					if (!root.inside (x))
+						return -1;
+					if (dirty)
+						build ();
+					return query (x);
+				}
+
+				// same, starting from the compartment the particle was in
+				int compartment (const Space & x, int hint)
+				{
+					if (hint < 0)
+						return compartment (x);
+					int c = hint;
+					while (c >= 0 && !contains (c, x))
+						c = comp[c].parent;
+					if (c < 0)
+						return -1;
+
+					for (;;)
+					{
+						const std::vector<int> & children = comp[c].children;
+						if (children.size() > maxChildScan)
+							return compartment (x);
+						int next = -1;
+						for (unsigned int k = 0; k < children.size() && next < 0; k++)
+							if (overlap (comp[children[k]].lo, comp[children[k]].hi, x) && contains (children[k], x))
+								next = children[k];
+						if (next < 0)
+							return c;
+						c = next;
+					}
+				}
+
+				// the outer box defines the domain
+				Space randomPoint () {return root.randomPoint ();};
+				template<class RNG>
+					Space randomPoint (RNG & engine) const {return root.randomPoint (engine);};
+				bool inside (const Space & x) const {return root.inside (x);};
+				double toBoundary (const Space & x, const Space & n) const {return root.toBoundary (x, n);};
+				double crossingProbability (const Space & x, const Space & xnew, double D, double dt) const
+				{
+					return root.crossingProbability (x, xnew, D, dt);
+				}
+				void reflect (Space & x) const {root.reflect (x);};
+
+				const Space & lower () const {return root.lower();};
+				const Space & upper () const {return root.upper();};
+
+			private:
+
+				struct Compartment
+				{
+					CompartmentShape shape;
+					Space c; // centre
+					Space h; // half sizes of a box
+					double R; // radius of a sphere
+					Space lo, hi; // bounding box
+					int parent;
+					int depth;
+					double D;
+					std::vector<int> children;
+				};
+
+				struct Node
+				{
+					Space lo, hi;
+					int left, right; // children, -1 for leaves
+					int c; // compartment in a leaf
+				};
+
+				// more children than this are looked up in the hierarchy
+				static const unsigned int maxChildScan = 8;
+
+				Space x0, H;
+				GeometryBox<ctype, dim> root;
+
+				std::vector<Compartment> comp;
+				std::vector<double> permeability;
+				std::vector<Node> bvh;
+				bool dirty;
+
+				int add (Compartment & c, double D, int parent)
+				{
+					c.parent = parent;
+					c.depth = comp.at(parent).depth + 1;
+					c.D = D;
+					bounds (c);
+					comp.push_back (c);
+					int id = comp.size() - 1;
+					comp[parent].children.push_back (id);
+
+					// grow the permeability matrix
+					int n = size ();
+					std::vector<double> t (n * n, HUGE_VAL);
+					for (int a = 0; a < n - 1; a++)
+						for (int b = 0; b < n - 1; b++)
+							t[a * n + b] = permeability[a * (n - 1) + b];
+					permeability.swap (t);
+
+					dirty = true;
+					return id;
+				}
+
+				static void bounds (Compartment & c)
+				{
+					for (int i = 0; i < dimension; i++)
+					{
+						double e = (c.shape == PDL_COMPARTMENT_BOX) ? c.h[i] : c.R;
+						c.lo[i] = c.c[i] - e;
+						c.hi[i] = c.c[i] + e;
+					}
+				}
+
+				static bool overlap (const Space & lo, const Space & hi, const Space & x)
+				{
+					for (int i = 0; i < dimension; i++)
+						if ( (x[i] > hi[i]) || (x[i] < lo[i]) )
+							return false;
+					return true;
+				}
+
+				void build ()
+				{
+					bvh.clear ();
+					std::vector<int> ids;
+					for (int c = 1; c < size(); c++)
+						ids.push_back (c);
+					if (!ids.empty())
+						build (ids, 0, ids.size());
+					dirty = false;
+				}
+
+				// median split along the longest axis of the centres
+				int build (std::vector<int> & ids, int begin, int end)
+				{
+					Node node;
+					node.lo = comp[ids[begin]].lo;
+					node.hi = comp[ids[begin]].hi;
+					Space clo = comp[ids[begin]].c, chi = clo;
+					for (int k = begin + 1; k < end; k++)
+					{
+						const Compartment & c = comp[ids[k]];
+						for (int i = 0; i < dimension; i++)
+						{
+							node.lo[i] = std::min (node.lo[i], c.lo[i]);
+							node.hi[i] = std::max (node.hi[i], c.hi[i]);
+							clo[i] = std::min (clo[i], c.c[i]);
+							chi[i] = std::max (chi[i], c.c[i]);
+						}
+					}
+
+					int id = bvh.size ();
+					bvh.push_back (node);
+					if (end - begin == 1)
+					{
+						bvh[id].left = bvh[id].right = -1;
+						bvh[id].c = ids[begin];
+						return id;
+					}
+
+					int axis = 0;
+					for (int i = 1; i < dimension; i++)
+						if (chi[i] - clo[i] > chi[axis] - clo[axis])
+							axis = i;
+
+					int mid = (begin + end) / 2;
+					const std::vector<Compartment> & cs = comp;
+					std::nth_element (ids.begin() + begin, ids.begin() + mid, ids.begin() + end,
+						[&cs, axis] (int a, int b) {return cs[a].c[axis] < cs[b].c[axis];});
+
+					int left = build (ids, begin, mid);
+					int right = build (ids, mid, end);
+					bvh[id].left = left;
+					bvh[id].right = right;
+					bvh[id].c = -1;
+					return id;
+				}
+
+				int query (const Space & x) const
+				{
+					int best = 0;
+					if (bvh.empty())
+						return best;
+
+					int stack[64];
+					int top = 0;
+					stack[top++] = 0;
+					while (top > 0)
+					{
+						const Node & node = bvh[stack[--top]];
+						if (!overlap (node.lo, node.hi, x))
+							continue;
+						if (node.c >= 0)
+						{
+							if (comp[node.c].depth > comp[best].depth && contains (node.c, x))
+								best = node.c;
+						}
+						else
+						{
+							stack[top++] = node.left;
+							stack[top++] = node.right;
+						}
+					}
+					return best;
+				}
+		};
+
+}; // namespace PDL
+
+#endif
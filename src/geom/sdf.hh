@@ -0,0 +1,408 @@
+// sdf.hh
+// voxelised geometry given by a signed distance function or a label image
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_GEO_SDF_HH
+# define PDLIB_GEO_SDF_HH
+
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+#include <stdexcept>
+
+#include <dune/common/fvector.hh>
+
+#include <pdlib/random.hh>
+#include <pdlib/geom/boundary.hh>
+
+#ifndef MAX_ATTEMPT
+#define MAX_ATTEMPT 100
+#endif
+
+namespace PDL
+{
+	// The domain is sampled once on a regular grid of voxels of size h: a
+	// signed distance field (negative inside) replaces analytic tests.
+	// inside () and the boundary treatment of moves use the same
+	// interpolated distance, so they agree; away from the boundary inside ()
+	// is a single lookup. toBoundary () along a direction sphere-traces the
+	// field.
+	template<typename ctype, int dim>
+		class GeometrySDF : public BoundaryCondition
+		{
+			public:
+				enum {dimension = dim};
+				typedef ctype type;
+				typedef typename Dune::FieldVector<ctype,dim>  Space;
+				typedef typename Dune::FieldVector<int,dim>  Index;
+
+				// sample an analytic signed distance function phi(x)
+				// (negative inside) in the box [xl, xr]
+				template<class SDF>
+					GeometrySDF (const Space & xl, const Space & xr, double h, const SDF & phi)
+						: xl (xl), h (h)
+					{
+						int total = 1;
+						for (int i = 0; i < dimension; i++)
+						{
+							n[i] = static_cast<int> (ceil ((xr[i] - xl[i]) / h));
+							total *= n[i];
+						}
+						this->xr = xl;
+						for (int i = 0; i < dimension; i++)
+							this->xr[i] += n[i] * h;
+
+						dist.resize (total);
+						for (int c = 0; c < total; c++)
+							dist[c] = phi (center (c));
+						setup ();
+					};
+
+				// label image with n voxels of size h, the corner at xl;
+				// voxels equal to label are inside
+				GeometrySDF (const Space & xl, double h, const Index & n,
+					const std::vector<int> & labels, int label)
+					: xl (xl), h (h), n (n)
+				{
+					int total = 1;
+					for (int i = 0; i < dimension; i++)
+						total *= n[i];
+					xr = xl;
+					for (int i = 0; i < dimension; i++)
+						xr[i] += n[i] * h;
+
+					std::vector<double> din (total), dout (total);
+					const double inf = 1e20;
+					for (int c = 0; c < total; c++)
+					{
+						bool in = (labels.at(c) == label);
+						din[c] = in ? inf : 0.;  // distance of inside voxels to outside ones
+						dout[c] = in ? 0. : inf; // and vice versa
+					}
+					transform (din);
+					transform (dout);
+
+					// voxel centres are half a voxel away from the surface
+					dist.resize (total);
+					for (int c = 0; c < total; c++)
+						dist[c] = (labels[c] == label) ? 0.5 * h - sqrt (din[c]) : sqrt (dout[c]) - 0.5 * h;
+					setup ();
+				};
+
+				// uniform in the domain: a point in a voxel near or inside
+				// the domain, rejected if outside
+				Space randomPoint ()
+				{
+					for (int attempt = 0; attempt < MAX_ATTEMPT; attempt++)
+					{
+						Space x = corner (voxels[rand() % voxels.size()]);
+						for (int i = 0; i < dimension; i++)
+							x[i] += static_cast <ctype> (rand()) / ( static_cast <ctype> (RAND_MAX / h));
+						if (inside (x))
+							return x;
+					}
+					return center (core);
+				}
+
+				// thread-safe version drawing from the caller's random engine
+				template<class RNG>
+					Space randomPoint (RNG & engine) const
+					{
+						std::uniform_int_distribution<int> v (0, voxels.size() - 1);
+						std::uniform_real_distribution<ctype> u (0., h);
+						for (int attempt = 0; attempt < MAX_ATTEMPT; attempt++)
+						{
+							Space x = corner (voxels[v (engine)]);
+							for (int i = 0; i < dimension; i++)
+								x[i] += u (engine);
+							if (inside (x))
+								return x;
+						}
+						return center (core);
+					}
+
+				// distance (x) <= 0; the field changes by less than margin
+				// within a voxel, so far from the boundary the voxel tells
+				bool inside (const Space & x) const
+				{
+					int c = voxel (x);
+					if (c < 0)
+						return false;
+					if (dist[c] < - margin)
+						return true;
+					if (dist[c] > margin)
+						return false;
+					return distance (x) <= 0.;
+				}
+
+				// signed distance to the boundary (negative inside),
+				// multilinear interpolation of the distance field
+				double distance (const Space & x) const
+				{
+					Index k;
+					double w[dim];
+					for (int i = 0; i < dimension; i++)
+					{
+						double s = (x[i] - xl[i]) / h - 0.5;
+						if (s < 0.) s = 0.;
+						if (s > n[i] - 1) s = n[i] - 1;
+						k[i] = static_cast<int> (s);
+						if (k[i] > n[i] - 2) k[i] = (n[i] > 1) ? n[i] - 2 : 0;
+						w[i] = s - k[i];
+					}
+
+					double d = 0.;
+					for (int v = 0; v < (1 << dim); v++)
+					{
+						double wc = 1.;
+						int c = 0;
+						for (int i = dimension - 1; i >= 0; i--)
+						{
+							int bit = (v >> i) & 1;
+							int ki = k[i] + bit;
+							if (ki >= n[i]) ki = n[i] - 1;
+							wc *= bit ? w[i] : 1. - w[i];
+							c = c * n[i] + ki;
+						}
+						d += wc * dist[c];
+					}
+
+					// outside the grid: add the distance to the grid
+					double e = 0.;
+					for (int i = 0; i < dimension; i++)
+					{
+						double o = (x[i] < xl[i]) ? xl[i] - x[i] : ((x[i] > xr[i]) ? x[i] - xr[i] : 0.);
+						e += o * o;
+					}
+					return d + sqrt (e);
+				}
+
+				// distance from x along n to the boundary (sphere tracing in
+				// the distance field); for n = 0 the distance in any
+				// direction, read from the field
+				double toBoundary (const Space & x, const Space & n) const
+				{
+					double norm = n.two_norm();
+					if (!(norm > 0.))
+						return fabs (distance (x));
+					Space u = n;
+					u /= norm;
+
+					const double eps = 1e-3 * h;
+					double tmax = (xr - xl).two_norm();
+					double t = 0.;
+					Space y = x;
+					for (int iter = 0; iter < 1000 && t < tmax; iter++)
+					{
+						double d = fabs (distance (y));
+						if (d < eps)
+							return t;
+						t += d;
+						y = x;
+						y.axpy (t, u);
+					}
+					return t;
+				}
+
+				// outward normal, the gradient of the distance field
+				Space normal (const Space & x) const
+				{
+					Space g, y = x;
+					for (int i = 0; i < dimension; i++)
+					{
+						y[i] = x[i] + 0.5 * h;
+						double dp = distance (y);
+						y[i] = x[i] - 0.5 * h;
+						g[i] = (dp - distance (y)) / h;
+						y[i] = x[i];
+					}
+					double norm = g.two_norm ();
+					if (norm > 0.)
+						g /= norm;
+					return g;
+				}
+
+				double crossingProbability (const Space & x, const Space & xnew, double D, double dt) const
+				{
+					if (!inside (xnew))
+						return 1.;
+					return bridgeProbability (- distance (x), - distance (xnew), D, dt);
+				}
+
+				// mirror a point outside at the (locally flat) boundary
+				void reflect (Space & x) const
+				{
+					for (int iter = 0; iter < 10 && !inside (x); iter++)
+					{
+						double d = distance (x);
+						x.axpy (- 2. * (d > 0. ? d : 0.5 * h), normal (x));
+					}
+					// still outside: push along the normal
+					for (int iter = 0; iter < 100 && !inside (x); iter++)
+						x.axpy (- 0.5 * h, normal (x));
+				}
+
+				const Space & lower () const {return xl;};
+				const Space & upper () const {return xr;};
+				double voxelSize () const {return h;};
+				// from the voxels with the centre inside
+				double volume () const
+				{
+					double v = ninside;
+					for (int i = 0; i < dimension; i++)
+						v *= h;
+					return v;
+				}
+
+			private:
+
+				Space xl, xr;
+				const double h;
+				Index n;
+
+				std::vector<ctype> dist; // signed distance at voxel centres
+				std::vector<int> voxels; // voxels which may hold inside points, for randomPoint
+				double margin; // bound on the change of the field within a voxel
+				int ninside; // voxels with the centre inside
+				int core; // one of them
+
+				void setup ()
+				{
+					margin = h * sqrt (static_cast<double> (dimension));
+					voxels.clear ();
+					ninside = 0;
+					core = -1;
+					for (unsigned int c = 0; c < dist.size(); c++)
+					{
+						if (dist[c] <= margin)
+							voxels.push_back (c);
+						if (dist[c] <= 0.)
+						{
+							ninside++;
+							if (core < 0 || dist[c] < dist[core])
+								core = c;
+						}
+					}
+					if (ninside == 0)
+						throw std::runtime_error ("GeometrySDF: the domain has no inside voxel");
+					Random::init (); // seed rand() unless seeded explicitly
+				}
+
+				int voxel (const Space & x) const
+				{
+					int c = 0;
+					for (int i = dimension - 1; i >= 0; i--)
+					{
+						if (x[i] < xl[i] || x[i] >= xr[i])
+							return -1;
+						int k = static_cast<int> ((x[i] - xl[i]) / h);
+						if (k >= n[i]) k = n[i] - 1;
+						c = c * n[i] + k;
+					}
+					return c;
+				}
+
+				Space corner (int c) const
+				{
+					Space x = xl;
+					for (int i = 0; i < dimension; i++)
+					{
+						x[i] += (c % n[i]) * h;
+						c /= n[i];
+					}
+					return x;
+				}
+
+				Space center (int c) const
+				{
+					Space x = corner (c);
+					for (int i = 0; i < dimension; i++)
+						x[i] += 0.5 * h;
+					return x;
+				}
+
+				// squared Euclidean distance transform, separable along the axes
+				// (Felzenszwalb & Huttenlocher, Theory of Computing 8, 415, 2012);
+				// f is 0 on the features and large elsewhere, the result is
+				// in physical units
+				void transform (std::vector<double> & f) const
+				{
+					int stride = 1;
+					for (int i = 0; i < dimension; i++)
+					{
+						int len = n[i];
+						std::vector<double> line (len), out (len);
+						for (unsigned int start = 0; start < f.size(); start++)
+						{
+							// start must be the first element of a line along axis i
+							if ((start / stride) % len != 0)
+								continue;
+							for (int k = 0; k < len; k++)
+								line[k] = f[start + k * stride];
+							transform1 (line, out);
+							for (int k = 0; k < len; k++)
+								f[start + k * stride] = out[k];
+						}
+						stride *= len;
+					}
+					for (unsigned int c = 0; c < f.size(); c++)
+						f[c] *= h * h;
+				}
+
+				static void transform1 (const std::vector<double> & f, std::vector<double> & d)
+				{
+					int len = f.size ();
+					std::vector<int> v (len);
+					std::vector<double> z (len + 1);
+					int k = 0;
+					v[0] = 0;
+					z[0] = - std::numeric_limits<double>::max();
+					z[1] = std::numeric_limits<double>::max();
+					for (int q = 1; q < len; q++)
+					{
+						double s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2. * q - 2. * v[k]);
+						while (s <= z[k])
+						{
+							k--;
+							s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2. * q - 2. * v[k]);
+						}
+						k++;
+						v[k] = q;
+						z[k] = s;
+						z[k + 1] = std::numeric_limits<double>::max();
+					}
+					k = 0;
+					for (int q = 0; q < len; q++)
+					{
+						while (z[k + 1] < q)
+							k++;
+						d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+					}
+				}
+		};
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,161 @@
+// sphere.hh
+// spherical (circular in 2D) geometry for system.hh
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_GEO_SPHERE_HH
+# define PDLIB_GEO_SPHERE_HH
+
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <random>
+
+#include <dune/common/fvector.hh>
+
+#include <pdlib/random.hh>
+#include <pdlib/geom/boundary.hh>
+
+namespace PDL
+{
+	template<typename ctype, int dim>
+		class GeometrySphere : public BoundaryCondition
+		{
+			public:
+				enum {dimension = dim};
+				typedef ctype type;
+				typedef typename Dune::FieldVector<ctype,dim>  Space;
+
+				GeometrySphere (const Space & c, double R)
+					: c(c), R(R)
+				{
+					for (int i = 0; i < dimension; i++)
+					{
+						xl[i] = c[i] - R;
+						xr[i] = c[i] + R;
+					}
+					Random::init (); // seed rand() unless seeded explicitly
+				};
+
+				Space randomPoint ()
+				{
+					Space x;
+					do
+					{
+						for (int i = 0; i < dim; i++)
+							x[i] = xl[i] + static_cast <ctype> (rand()) /( static_cast <ctype> (RAND_MAX/(2. * R)));
+					}
+					while (!inside (x));
+					return x;
+				}
+
+				// thread-safe version drawing from the caller's random engine
+				template<class RNG>
+					Space randomPoint (RNG & engine) const
+					{
+						std::uniform_real_distribution<ctype> u (-R, R);
+						Space x;
+						do
+						{
+							for (int i = 0; i < dim; i++)
+								x[i] = c[i] + u (engine);
+						}
+						while (!inside (x));
+						return x;
+					}
+
+				bool inside (const Space & x) const
+				{
+					Space d = x;
+					d -= c;
+					return d.two_norm2() <= R * R;
+				};
+
+				// signed distance to the surface, negative inside
+				double distance (const Space & x) const
+				{
+					Space d = x;
+					d -= c;
+					return d.two_norm() - R;
+				}
+
+				double toBoundary (const Space & x, const Space & n) const
+				{
+					// no direction: the distance to the surface along the radius
+					double norm = n.two_norm();
+					if (!(norm > 0.))
+						return fabs (distance (x));
+
+					// solve |x - c + t u| = R for the positive root
+					Space u = n;
+					u /= norm;
+					Space d = x;
+					d -= c;
+					double b = d * u;
+					double q = b * b - d.two_norm2() + R * R;
+					if (q < 0.)
+						return 0.;
+					double t = - b + sqrt (q);
+					return (t > 0.) ? t : 0.;
+				};
+
+				double crossingProbability (const Space & x, const Space & xnew, double D, double dt) const
+				{
+					if (!inside (xnew))
+						return 1.;
+					return bridgeProbability (- distance (x), - distance (xnew), D, dt);
+				}
+
+				// mirror a point outside at the tangent plane
+				void reflect (Space & x) const
+				{
+					Space d = x;
+					d -= c;
+					double r = d.two_norm ();
+					if (r <= R)
+						return;
+					double rnew = 2. * R - r;
+					if (rnew < 0.)
+						rnew = 0.;
+					d *= rnew / r;
+					x = c;
+					x += d;
+				}
+
+				const Space & center () const {return c;};
+				double radius () const {return R;};
+
+				// bounding box corners
+				const Space & lower () const {return xl;};
+				const Space & upper () const {return xr;};
+
+			private:
+
+				Space c;
+				const double R;
+
+				Space xl;
+				Space xr;
+		};
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,112 @@
+/* testBoundary.cc  2015-07-06 test absorbing boundaries
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <cmath>
+
+#include <pdlib/geom/box.hh>
+#include <pdlib/particles/pbp.hh>
+
+// Survival in the slab |x| < a with the Robin condition D du/dn = - kappa u,
+// started uniformly: a sum over the modes cos (alpha x) with
+// alpha tan (alpha a) = kappa / D
+double robinSurvival (double a, double D, double kappa, double t)
+{
+	double S = 0.;
+	for (int n = 0; n < 2000; n++)
+	{
+		// alpha a in (n pi, n pi + pi/2)
+		double lo = n * M_PI, hi = n * M_PI + 0.5 * M_PI;
+		for (int i = 0; i < 100; i++)
+		{
+			double z = 0.5 * (lo + hi);
+			if (z * tan (z) < kappa * a / D)
+				lo = z;
+			else
+				hi = z;
+		}
+		double alpha = 0.5 * (lo + hi) / a;
+		double s = 2. * sin (alpha * a) / alpha;
+		S += s * s / (2. * a) / (a + sin (2. * alpha * a) / (2. * alpha)) * exp (- D * alpha * alpha * t);
+	}
+	return S;
+}
+
+// Mean exit time from a slab of width L starting in the middle is L^2/(8D),
+// which should not depend on the time step; with a reactive boundary, the
+// survival follows the Robin boundary condition
+int main (int argc, char ** argv) 
+{
+	Dune::FieldVector<double, 2> x0;
+	x0[0] = 0.; x0[1] = 0.;
+
+	Dune::FieldVector<double, 2> H;
+	H[0] = 1.; H[1] = 1000.;
+
+	typedef PDL::GeometryBox<double, 2> Box;
+	Box b (x0,H);
+	b.setBoundary (PDL::PDL_BOUNDARY_ABSORBING);
+
+	double D = 1.;
+	int N = 2000;
+
+	std::cerr << "exact: " << 1. / (8. * D) << std::endl;
+	for (double dt = 1e-2; dt > 1e-5; dt /= 10.)
+	{
+		double T = 0.;
+		for (int n = 0; n < N; n++)
+		{
+			PDL::BrownianParticle<Box> p (x0, D, dt);
+			double t = 0.;
+			while (!p.absorbed ())
+			{
+				p.move (dt, b);
+				t += dt;
+			}
+			T += t - 0.5 * dt; // absorption happens within the last step
+		}
+		std::cerr << "dt=" << dt << " mean exit time: " << T / N << std::endl;
+	}
+
+	double kappa = 0.5, a = 0.5 * H[0], T = 0.2;
+	b.setBoundary (PDL::PDL_BOUNDARY_REACTIVE, kappa);
+	N = 20000;
+	std::cerr << "reactive, kappa = " << kappa << ": survival at t = " << T << " "
+		<< robinSurvival (a, D, kappa, T) << " (Robin)" << std::endl;
+	std::mt19937 engine (1);
+	std::uniform_real_distribution<double> u (- a, a);
+	for (double dt = 1e-2; dt > 1e-4; dt /= 10.)
+	{
+		int alive = 0;
+		for (int n = 0; n < N; n++)
+		{
+			Dune::FieldVector<double, 2> x (0.);
+			x[0] = u (engine);
+			PDL::BrownianParticle<Box> p (x, D, dt);
+			for (int k = 0; k * dt < T - 0.5 * dt && !p.absorbed (); k++)
+				p.move (dt, b);
+			if (!p.absorbed ())
+				alive++;
+		}
+		std::cerr << "dt=" << dt << " survival: " << alive / (double) N
+			<< " +- " << 2. * sqrt (alive * (N - alive) / (double) N) / N << std::endl;
+	}
+
+	return 1;
+}
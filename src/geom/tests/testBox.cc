@@ -17,6 +17,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#include <random>
+
 #include <pdlib/geom/box.hh>
 
 int main (int argc, char ** argv) 
@@ -40,6 +42,17 @@ int main (int argc, char ** argv)
 
 	std::cerr << "distance from (" << x << ") along (" << n << "): " << b.toBoundary(x,n) << std::endl;
 
+	// single precision box whose corners are not exact in float: random
+	// points stay inside
+	Dune::FieldVector<float, 2> y0 (1000.3f), L (0.7f);
+	PDL::GeometryBox<float, 2> bf (y0, L);
+	std::mt19937 engine (1);
+	int outside = 0;
+	for (int i = 0; i < 1000000; i++)
+		if (!bf.inside (bf.randomPoint ()) || !bf.inside (bf.randomPoint (engine)))
+			outside++;
+	std::cerr << "float random points outside the box: " << outside << " of 1000000" << std::endl;
+
 	return 1;
 }
 
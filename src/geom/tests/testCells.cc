@@ -0,0 +1,79 @@
+/* testCells.cc  2015-07-28 test spatial queries of System
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <algorithm>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+
+typedef PDL::GeometryBox<double, 3> Box;
+typedef PDL::SpeciesFactory<Box> Factory;
+typedef PDL::System<Box, Factory> System;
+
+int main (int argc, char ** argv) 
+{
+	Box::Space x0 (0.), H (10.);
+	Box b (x0, H);
+
+	PDL::ReactionNetwork net;
+	int A = net.addSpecies ("A", 0.1);
+	double dt = 0.1;
+	Factory F (net, dt);
+
+	System system (b, F);
+	system.addParticles (20000, A);
+	system.enableSpatialIndex (0.5);
+
+	// the index follows the particles
+	for (int i = 0; i < 10; i++)
+		system.evolve (dt);
+
+	int wrong = 0;
+	for (int q = 0; q < 100; q++)
+	{
+		Box::Space x = b.randomPoint ();
+		double r = 0.5 + q * 0.01;
+
+		int n = 0;
+		std::vector<double> d;
+		for (int i = 0; i < system.getNParticles(); i++)
+		{
+			double di = (system.getParticle(i)->position() - x).two_norm ();
+			d.push_back (di);
+			if (di <= r)
+				n++;
+		}
+		std::sort (d.begin(), d.end());
+
+		if (system.countInSphere (x, r) != n)
+			wrong++;
+
+		std::vector<const Factory::Particle*> nn = system.nearest (x, 5);
+		for (int k = 0; k < 5; k++)
+			if (fabs ((nn[k]->position() - x).two_norm () - d[k]) > 1e-12)
+				wrong++;
+		if (!system.nearest (x, 0).empty ())
+			wrong++;
+	}
+	std::cerr << "wrong answers: " << wrong << std::endl;
+
+	return 1;
+}
@@ -0,0 +1,109 @@
+/* testComposite.cc  2015-07-14 test GeometryComposite class
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+
+#include <pdlib/geom/composite.hh>
+#include <pdlib/geom/sphere.hh>
+#include <pdlib/particles/cbp.hh>
+
+typedef Dune::FieldVector<double, 3> Space;
+typedef PDL::GeometryComposite<double, 3> Cell;
+
+int main (int argc, char ** argv) 
+{
+	// cytoplasm with a nucleus and a few hundred organelles
+	Space x0 (0.), H (10.);
+	Cell cell (x0, H, 0.1);
+
+	PDL::GeometrySphere<double, 3> n (x0, 2.);
+	int nucleus = cell.addSphere (n.center(), n.radius(), 0.01);
+	cell.setPermeability (nucleus, 0, 0.002); // nuclear export
+	cell.setPermeability (0, nucleus, 0.);
+
+	std::vector<Space> organelles;
+	for (int i = 0; i < 400; i++)
+	{
+		Space c = cell.randomPoint ();
+		if (c.two_norm () < 2.5 || c.two_norm () > 4.5)
+			continue;
+		bool free = true;
+		for (unsigned int k = 0; k < organelles.size(); k++)
+			if ((c - organelles[k]).two_norm () < 0.2)
+				free = false;
+		if (!free)
+			continue;
+		organelles.push_back (c);
+		cell.addSphere (c, 0.1, 0.001);
+	}
+	std::cerr << cell.size () << " compartments" << std::endl;
+
+	// BVH lookup against a linear scan
+	int wrong = 0;
+	for (int k = 0; k < 100000; k++)
+	{
+		Space x = cell.randomPoint ();
+		int expected = 0;
+		for (int i = 1; i < cell.size(); i++)
+			if (cell.contains (i, x))
+				expected = i;
+		if (cell.compartment (x) != expected)
+			wrong++;
+	}
+	std::cerr << "misclassified: " << wrong << " of 100000" << std::endl;
+
+	// lookup from the compartment of a nearby point, and in a copy
+	Cell copy (cell);
+	wrong = 0;
+	for (int k = 0; k < 100000; k++)
+	{
+		Space x = cell.randomPoint (), y = x;
+		for (int i = 0; i < 3; i++)
+			y[i] += 0.2 * (rand () / (RAND_MAX + 1.) - 0.5);
+		if (!cell.inside (y))
+			continue;
+		if (cell.compartment (y, cell.compartment (x)) != cell.compartment (y)
+				|| copy.compartment (y, copy.compartment (x)) != cell.compartment (y))
+			wrong++;
+	}
+	std::cerr << "misclassified from a hint: " << wrong << std::endl;
+
+	// a zero direction gives the distance to the surface along the radius
+	Space y = x0;
+	y[0] += 0.5;
+	std::cerr << "to the nuclear envelope without a direction: "
+		<< n.toBoundary (y, Space (0.)) << " (1.5)" << std::endl;
+
+	// mRNA leaving the nucleus, about the same at both time steps
+	for (double dt = 0.1; dt > 0.02; dt /= 4.)
+	{
+		int out = 0;
+		for (int k = 0; k < 200; k++)
+		{
+			PDL::CompartmentParticle<Cell> m (x0, cell, dt);
+			for (int i = 0; i * dt < 100.; i++)
+				m.move (dt, cell);
+			if (m.compartment () != nucleus)
+				out++;
+		}
+		std::cerr << "dt = " << dt << ": " << out << " of 200 mRNA left the nucleus in 100 s" << std::endl;
+	}
+
+	return 1;
+}
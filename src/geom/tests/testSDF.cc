@@ -0,0 +1,108 @@
+/* testSDF.cc  2015-07-10 test GeometrySDF class
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <stdexcept>
+
+#include <pdlib/geom/sdf.hh>
+
+typedef Dune::FieldVector<double, 3> Space;
+
+// rod-shaped cell: a spherocylinder of radius R and length 2L along x
+class Rod
+{
+	public:
+		Rod (double R, double L) : R(R), L(L) {};
+		double operator() (const Space & x) const
+		{
+			double s = fabs (x[0]) - L;
+			double a = (s > 0.) ? s : 0.;
+			return sqrt (a * a + x[1] * x[1] + x[2] * x[2]) - R;
+		}
+	private:
+		const double R, L;
+};
+
+int main (int argc, char ** argv) 
+{
+	Rod rod (0.5, 1.);
+	Space xl (-2.), xr (2.);
+
+	PDL::GeometrySDF<double, 3> g (xl, xr, 0.05, rod);
+	std::cerr << "volume: " << g.volume () << " (" 
+		<< M_PI * 0.25 * 2. + 4. / 3. * M_PI * 0.125 << ")" << std::endl;
+
+	// the same cell from a label image
+	Dune::FieldVector<int, 3> n (80);
+	std::vector<int> labels (80 * 80 * 80);
+	for (int c = 0; c < 80 * 80 * 80; c++)
+	{
+		Space x;
+		x[0] = -2. + (c % 80 + 0.5) * 0.05;
+		x[1] = -2. + ((c / 80) % 80 + 0.5) * 0.05;
+		x[2] = -2. + (c / 6400 + 0.5) * 0.05;
+		labels[c] = (rod (x) <= 0.) ? 1 : 0;
+	}
+	PDL::GeometrySDF<double, 3> img (xl, 0.05, n, labels, 1);
+
+	int wrong = 0;
+	double err = 0.;
+	for (int i = 0; i < 100000; i++)
+	{
+		Space x;
+		for (int k = 0; k < 3; k++)
+			x[k] = -2. + 4. * rand () / (double) RAND_MAX;
+		if (g.inside (x) != (rod (x) <= 0.))
+			wrong++;
+		err = std::max (err, fabs (img.distance (x) - rod (x)));
+	}
+	std::cerr << "misclassified: " << wrong << " of 100000" << std::endl;
+	std::cerr << "max distance error of the label image: " << err << std::endl;
+
+	Space x (0.), d (0.);
+	d[1] = 1.;
+	std::cerr << "distance from (" << x << ") along (" << d << "): " << g.toBoundary (x, d) << " (0.5)" << std::endl;
+	std::cerr << "distance from (" << x << ") in any direction: " << g.toBoundary (x, Space (0.)) << " (0.5)" << std::endl;
+
+	// a point inside does not leave in a step of zero length
+	int leave = 0, accepted = 0;
+	for (int i = 0; i < 100000; i++)
+	{
+		Space y = g.randomPoint ();
+		if (!g.inside (y))
+			continue;
+		accepted++;
+		if (g.crossingProbability (y, y, 1., 1e-4) >= 1.)
+			leave++;
+	}
+	std::cerr << "random points inside: " << accepted << " of 100000, certain to leave in place: " << leave << std::endl;
+
+	// a domain without inside voxels is refused
+	try
+	{
+		PDL::GeometrySDF<double, 3> empty (xl, 0.05, n, std::vector<int> (80 * 80 * 80, 0), 1);
+		std::cerr << "empty domain: accepted" << std::endl;
+	}
+	catch (std::runtime_error & e)
+	{
+		std::cerr << "empty domain: " << e.what () << std::endl;
+	}
+
+	return 1;
+}
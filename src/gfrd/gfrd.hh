@@ -0,0 +1,314 @@
+// gfrd.hh
+// event driven Green's function dynamics for sparse systems
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_GFRD_GFRD_HH
+# define PDLIB_GFRD_GFRD_HH
+
+#include <vector>
+#include <ostream>
+#include <algorithm>
+#include <random>
+#include <limits>
+#include <cmath>
+
+#include <pdlib/io/journal.hh>
+#include <pdlib/gfrd/greens.hh>
+
+namespace PDL
+{
+	// Green's function reaction dynamics (van Zon and ten Wolde) for a
+	// System with first order reactions (e.g., CompiledNetwork) in a box.
+	//
+	// With first order reactions only, particles never wait for each other
+	// (there are no pairs to protect): each particle and its products are
+	// carried to the end time in turn, from one event to the next. The time
+	// of the next reaction is drawn exactly, from the particle's own random
+	// engine as in CompiledNetwork, and so is the position at the event:
+	//
+	// - with reflecting (or rejecting, its continuum limit) walls the box
+	//   itself is the protective domain, and the position at any time comes
+	//   from the Green's function of the box (a product of intervals with
+	//   reflecting ends): a particle is moved once per reaction and once
+	//   per advance (), whatever its time step;
+	//
+	// - with absorbing or reactive walls a particle gets a protective cube,
+	//   as large as the walls allow (or maxDomain), with absorbing faces.
+	//   Exit time and exit point are drawn from its Green's function; if a
+	//   reaction or the end of advance () comes first, the position is drawn
+	//   conditioned on not having left. Particles closer to a wall than
+	//   minDomain Brownian steps of their own (sqrt (2 D dt) each) step as in
+	//   System::evolve, until they are out again.
+	//
+	// Events go to the journal of the system (if any) with the time they
+	// happened at, in the order of time at the end of advance ().
+	template<class S, class Reaction>
+		class GFRD
+		{
+			public:
+				typedef typename S::Particle Particle;
+				typedef typename Particle::Space Space;
+				enum {dimension = Space::dimension};
+
+				GFRD (S & system, Reaction & rxn)
+					: system (system), geo (system.geometry ()), rxn (rxn), minDomain (3.),
+					maxDomain (std::numeric_limits<double>::max()),
+					exits (0), bursts (0), steps (0), reactions (0), journal (nullptr) {};
+
+				// with absorbing or reactive walls: domains smaller than n
+				// Brownian steps are not used, nor larger than a
+				void setMinDomain (double n) {minDomain = n;};
+				void setMaxDomain (double a) {maxDomain = a;};
+
+				// advance the system from its time to t1
+				void advance (double t1)
+				{
+					std::vector<std::pair<Particle*, double> > work;
+					double t0 = system.time ();
+					for (int i = 0; i < system.getNParticles (); i++)
+						work.push_back (std::make_pair (system.getParticle (i), t0));
+
+					// particles are carried in turn, so events come out of
+					// order: they are held back and journaled sorted
+					journal = system.getJournal ();
+					if (journal)
+						system.setJournal (nullptr);
+					events.clear ();
+					dead.clear ();
+					while (!work.empty())
+					{
+						std::pair<Particle*, double> w = work.back ();
+						work.pop_back ();
+						propagate (w.first, w.second, t1, work);
+					}
+
+					std::sort (dead.begin(), dead.end());
+					system.removeParticles ([this] (const Particle * p)
+						{return std::binary_search (dead.begin(), dead.end(), p);});
+					system.setTime (t1);
+
+					if (journal)
+					{
+						std::stable_sort (events.begin(), events.end(),
+							[] (const JournalEvent & a, const JournalEvent & b) {return a.time < b.time;});
+						for (unsigned int i = 0; i < events.size(); i++)
+							journal->record (static_cast<JournalEventType> (events[i].kind), events[i].time,
+								events[i].particle, events[i].type, events[i].reaction);
+						system.setJournal (journal, false);
+						journal->step (system);
+					}
+				}
+
+				// domain exits, positions drawn inside domains, Brownian steps
+				// near walls and reactions so far
+				unsigned long int nExits () const {return exits;};
+				unsigned long int nBursts () const {return bursts;};
+				unsigned long int nSteps () const {return steps;};
+				unsigned long int nReactions () const {return reactions;};
+
+				void print (std::ostream * stream) const
+				{
+					*stream << exits << " exits, " << bursts << " bursts, " << steps
+						<< " Brownian steps, " << reactions << " reactions" << std::endl;
+				}
+
+			private:
+				typedef typename S::GeometryType Geometry;
+
+				S & system;
+				Geometry & geo;
+				Reaction & rxn;
+				double minDomain, maxDomain;
+				unsigned long int exits, bursts, steps, reactions;
+				std::vector<const Particle*> dead;
+				std::vector<Particle*> products;
+				EventJournal * journal; // of the system, during advance ()
+				std::vector<JournalEvent> events;
+
+				void note (JournalEventType kind, double t, const Particle * p, int reaction = -1)
+				{
+					if (journal)
+					{
+						JournalEvent e = {t, p->getNumber (), kind, p->type (), reaction, 0};
+						events.push_back (e);
+					}
+				}
+
+				// carry p from t to t1, queueing its products
+				void propagate (Particle * p, double t, double t1,
+					std::vector<std::pair<Particle*, double> > & work)
+				{
+					std::mt19937 & engine = p->randomEngine ();
+					std::exponential_distribution<double> exponential (1.);
+					const double inf = std::numeric_limits<double>::infinity();
+					double D = p->getD ();
+					double k = rxn.rate (p->type ());
+					double tr = (k > 0.) ? t + exponential (engine) / k : inf;
+
+					while (t < t1)
+					{
+						double tend = std::min (tr, t1);
+						if (D == 0.)
+							t = tend;
+						else
+						{
+							Space x = p->position ();
+							double a = reflecting () ? 0. : halfWidth (x);
+							double h = p->getDt ();
+							if (reflecting ())
+							{
+								// the whole box
+								bursts++;
+								Space y;
+								for (int i = 0; i < dimension; i++)
+								{
+									double L = geo.upper ()[i] - geo.lower ()[i];
+									double z0 = (x[i] - geo.lower ()[i]) / L;
+									y[i] = geo.lower ()[i] + L * ReflectingGreensFunction::position (z0, D * (tend - t) / (L * L), engine);
+								}
+								system.setPosition (p, y);
+								t = tend;
+								if (t < tr)
+									continue;
+							}
+							else if (a < minDomain * sqrt (2. * D * h))
+							{
+								// near a wall
+								steps++;
+								double tau = std::min (h, tend - t);
+								if (!step (p, D, tau, t + tau))
+									return; // absorbed
+								t = (t + h < tend) ? t + h : tend;
+								if (t < tr)
+									continue;
+							}
+							else
+							{
+								// exit times of the intervals, the first one wins
+								int j = 0;
+								double s = inf;
+								for (int i = 0; i < dimension; i++)
+								{
+									double si = IntervalGreensFunction::exitTime (engine);
+									if (si < s)
+									{
+										s = si;
+										j = i;
+									}
+								}
+								double texit = t + s * a * a / D;
+
+								Space y = x;
+								if (texit < tend)
+								{
+									exits++;
+									for (int i = 0; i < dimension; i++)
+										if (i != j)
+											y[i] += a * IntervalGreensFunction::position (s, engine);
+									y[j] += (engine () & 1) ? a : -a;
+									t = texit;
+								}
+								else
+								{
+									bursts++;
+									double sb = D * (tend - t) / (a * a);
+									for (int i = 0; i < dimension; i++)
+										y[i] += a * IntervalGreensFunction::position (sb, engine);
+									t = tend;
+								}
+								system.setPosition (p, y);
+								if (t < tr)
+									continue;
+							}
+						}
+
+						if (t >= t1)
+							break;
+
+						// the reaction at t = tr, all branching ratios exact
+						reactions++;
+						products.clear ();
+						bool consumed = rxn.apply (p, inf, &products);
+						int id = journal ? lastReactionOf (rxn, 0) : -1;
+						for (unsigned int i = 0; i < products.size(); i++)
+						{
+							system.addParticle (products[i]);
+							note (PDL_EVENT_BIRTH, t, products[i], id);
+							work.push_back (std::make_pair (products[i], t));
+						}
+						if (consumed && p->remove ())
+						{
+							note (PDL_EVENT_DEATH, t, p, id);
+							dead.push_back (p);
+							return;
+						}
+						tr = t + exponential (engine) / k;
+					}
+				}
+
+				bool reflecting () const
+				{
+					return geo.boundary () == PDL_BOUNDARY_REFLECTING || geo.boundary () == PDL_BOUNDARY_REJECTING;
+				}
+
+				// half width of the largest cube around x in the bounding box
+				double halfWidth (const Space & x) const
+				{
+					double a = maxDomain;
+					for (int i = 0; i < dimension; i++)
+						a = std::min (a, std::min (x[i] - geo.lower ()[i], geo.upper ()[i] - x[i]));
+					return a;
+				}
+
+				// a Brownian step of length tau, ending at t, at an absorbing or
+				// reactive wall (as BrownianParticle::move, for any tau); false
+				// if absorbed
+				bool step (Particle * p, double D, double tau, double t)
+				{
+					std::mt19937 & engine = p->randomEngine ();
+					std::normal_distribution<double> normal (0., sqrt (2. * D * tau));
+					std::uniform_real_distribution<double> uniform (0., 1.);
+					Space x = p->position ();
+					Space y = x;
+					for (int i = 0; i < dimension; i++)
+						y[i] += normal (engine);
+
+					double c = contactProbability (geo, x, y, D, tau);
+					if (c > 0. && uniform (engine) < c
+						&& uniform (engine) < geo.absorptionProbability (D, tau))
+					{
+						note (PDL_EVENT_ABSORB, t, p);
+						dead.push_back (p);
+						return false;
+					}
+					if (!geo.inside (y))
+						geo.reflect (y);
+					system.setPosition (p, y);
+					return true;
+				}
+
+				GFRD (const GFRD &);
+		};
+
+}; // namespace PDL
+
+#endif
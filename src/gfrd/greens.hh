@@ -0,0 +1,254 @@
+// greens.hh
+// Green's functions of free diffusion in an interval
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_GFRD_GREENS_HH
+# define PDLIB_GFRD_GREENS_HH
+
+#include <cmath>
+#include <algorithm>
+#include <random>
+
+namespace PDL
+{
+	// solve F (x) = u for an increasing F with derivative f on [lo, hi]:
+	// Newton steps from x, bisection whenever a step leaves the bracket
+	template<class Cdf, class Pdf>
+		double invertCDF (const Cdf & F, const Pdf & f, double u, double lo, double hi, double x)
+		{
+			for (int i = 0; i < 100; i++)
+			{
+				double r = F (x) - u;
+				if (r < 0.)
+					lo = x;
+				else
+					hi = x;
+				double d = f (x);
+				double xn = (d > 0.) ? x - r / d : lo - 1.;
+				if (!(xn > lo && xn < hi))
+					xn = 0.5 * (lo + hi);
+				if (fabs (xn - x) < 1e-12 * (1. + fabs (x)) || hi - lo < 1e-12)
+					return xn;
+				x = xn;
+			}
+			return x;
+		}
+
+	// A particle starts at the centre of [-1, 1] with absorbing ends; in the
+	// reduced time s = D t / a^2 (a the half width of the real interval):
+	//
+	// - cdf (y, s): probability to be in [-1, y] at s, not absorbed
+	// - survival (s): probability not to be absorbed by s
+	//
+	// For small s the image series converges fast, for large s the
+	// eigenfunction series; they are switched at s = 1/4, where both are
+	// accurate to machine precision with a few terms.
+	class IntervalGreensFunction
+	{
+		public:
+			static double cdf (double y, double s)
+			{
+				if (y <= -1.)
+					return 0.;
+				if (y > 1.)
+					y = 1.;
+				if (s <= 0.)
+					return (y >= 0.) ? 1. : 0.;
+
+				double P = 0.;
+				if (s < 0.25)
+				{
+					// images of alternating sign at 2n
+					double sigma = sqrt (2. * s);
+					for (int n = -4; n <= 4; n++)
+						P += sign (n) * (Phi ((y - 2. * n) / sigma) - Phi ((-1. - 2. * n) / sigma));
+				}
+				else
+				{
+					// sin (k pi/2) sin (k pi z/2) exp (- k^2 pi^2 s/4), z = y + 1
+					for (int k = 1; k <= terms (s / 4.); k += 2)
+						P += sign ((k - 1) / 2) * 2. / (k * M_PI) * (1. - cos (k * M_PI * (y + 1.) / 2.))
+							* exp (- k * k * M_PI * M_PI * s / 4.);
+				}
+				return (P > 0.) ? P : 0.;
+			}
+
+			static double pdf (double y, double s)
+			{
+				double p = 0.;
+				if (s < 0.25)
+				{
+					double sigma = sqrt (2. * s);
+					for (int n = -4; n <= 4; n++)
+						p += sign (n) * phi ((y - 2. * n) / sigma) / sigma;
+				}
+				else
+					for (int k = 1; k <= terms (s / 4.); k += 2)
+						p += sign ((k - 1) / 2) * sin (k * M_PI * (y + 1.) / 2.) * exp (- k * k * M_PI * M_PI * s / 4.);
+				return (p > 0.) ? p : 0.;
+			}
+
+			static double survival (double s)
+			{
+				if (s <= 0.)
+					return 1.;
+				double S = 0.;
+				if (s < 0.25)
+				{
+					// 1 - 2 sum (-1)^n erfc ((2n + 1) / sqrt (4 s))
+					S = 1.;
+					for (int n = 0; n <= 4; n++)
+						S -= 2. * sign (n) * erfc ((2 * n + 1) / sqrt (4. * s));
+				}
+				else
+					for (int k = 1; k <= terms (s / 4.); k += 2)
+						S += sign ((k - 1) / 2) * 4. / (k * M_PI) * exp (- k * k * M_PI * M_PI * s / 4.);
+				return std::min (std::max (S, 0.), 1.);
+			}
+
+			// the exit time density, - dS/ds
+			static double flux (double s)
+			{
+				if (s <= 0.)
+					return 0.;
+				double f = 0.;
+				if (s < 0.25)
+					for (int n = 0; n <= 4; n++)
+					{
+						double c = 2 * n + 1;
+						f += sign (n) * c / (sqrt (M_PI) * s * sqrt (s)) * exp (- c * c / (4. * s));
+					}
+				else
+					for (int k = 1; k <= terms (s / 4.); k += 2)
+						f += sign ((k - 1) / 2) * k * M_PI * exp (- k * k * M_PI * M_PI * s / 4.);
+				return (f > 0.) ? f : 0.;
+			}
+
+			// reduced first exit time, S (s) = u (solved for ln s)
+			template<class RNG>
+			static double exitTime (RNG & engine)
+			{
+				std::uniform_real_distribution<double> uniform (0., 1.);
+				double u = uniform (engine);
+				double x = invertCDF (
+					[] (double x) {return 1. - survival (exp (x));},
+					[] (double x) {return exp (x) * flux (exp (x));},
+					1. - u, -20., 5., log (0.2));
+				return exp (x);
+			}
+
+			// position in [-1, 1] at s, given the particle was not absorbed
+			template<class RNG>
+			static double position (double s, RNG & engine)
+			{
+				std::uniform_real_distribution<double> uniform (0., 1.);
+				double u = uniform (engine) * survival (s);
+				return invertCDF (
+					[s] (double y) {return cdf (y, s);},
+					[s] (double y) {return pdf (y, s);},
+					u, -1., 1., 0.);
+			}
+
+		private:
+			static double Phi (double x) {return 0.5 * erfc (- x / M_SQRT2);};
+			static double phi (double x) {return exp (- 0.5 * x * x) / sqrt (2. * M_PI);};
+			static double sign (int n) {return (n % 2) ? -1. : 1.;};
+
+			// odd terms of the eigenfunction series above 1e-16
+			static int terms (double s) {return std::min (15, 2 + static_cast<int> (sqrt (37. / (M_PI * M_PI * s))));};
+	};
+
+	// A particle starts at z0 in [0, 1] with reflecting ends; in the reduced
+	// time s = D t / L^2 (L the length of the real interval), cdf (z, z0, s)
+	// is the probability to be in [0, z] at s. Images for s < 1/10, the
+	// cosine series otherwise.
+	class ReflectingGreensFunction
+	{
+		public:
+			static double cdf (double z, double z0, double s)
+			{
+				if (z <= 0.)
+					return 0.;
+				if (z >= 1.)
+					return 1.;
+				if (s <= 0.)
+					return (z >= z0) ? 1. : 0.;
+
+				double P = 0.;
+				if (s < 0.1)
+				{
+					// images at 2n +- z0
+					double sigma = sqrt (2. * s);
+					for (int n = -3; n <= 3; n++)
+						P += Phi ((z - z0 - 2. * n) / sigma) - Phi ((- z0 - 2. * n) / sigma)
+							+ Phi ((z + z0 - 2. * n) / sigma) - Phi ((z0 - 2. * n) / sigma);
+				}
+				else
+				{
+					P = z;
+					for (int k = 1; k <= terms (s); k++)
+						P += 2. / (k * M_PI) * cos (k * M_PI * z0) * sin (k * M_PI * z)
+							* exp (- k * k * M_PI * M_PI * s);
+				}
+				return std::min (std::max (P, 0.), 1.);
+			}
+
+			static double pdf (double z, double z0, double s)
+			{
+				double p = 0.;
+				if (s < 0.1)
+				{
+					double sigma = sqrt (2. * s);
+					for (int n = -3; n <= 3; n++)
+						p += (phi ((z - z0 - 2. * n) / sigma) + phi ((z + z0 - 2. * n) / sigma)) / sigma;
+				}
+				else
+				{
+					p = 1.;
+					for (int k = 1; k <= terms (s); k++)
+						p += 2. * cos (k * M_PI * z0) * cos (k * M_PI * z) * exp (- k * k * M_PI * M_PI * s);
+				}
+				return (p > 0.) ? p : 0.;
+			}
+
+			template<class RNG>
+			static double position (double z0, double s, RNG & engine)
+			{
+				std::uniform_real_distribution<double> uniform (0., 1.);
+				double u = uniform (engine);
+				return invertCDF (
+					[z0, s] (double z) {return cdf (z, z0, s);},
+					[z0, s] (double z) {return pdf (z, z0, s);},
+					u, 0., 1., (s < 0.1) ? z0 : u);
+			}
+
+		private:
+			static double Phi (double x) {return 0.5 * erfc (- x / M_SQRT2);};
+			static double phi (double x) {return exp (- 0.5 * x * x) / sqrt (2. * M_PI);};
+
+			// terms of the cosine series above 1e-16
+			static int terms (double s) {return std::min (12, 1 + static_cast<int> (sqrt (37. / (M_PI * M_PI * s))));};
+	};
+
+}; // namespace PDL
+
+#endif
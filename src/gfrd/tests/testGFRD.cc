@@ -0,0 +1,177 @@
+/* testGFRD.cc  2015-08-17 Green's function dynamics against Brownian dynamics
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <chrono>
+#include <random>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/observables/stat.hh>
+#include <pdlib/gfrd/gfrd.hh>
+
+typedef PDL::GeometryBox<double, 3> Box;
+typedef PDL::SpeciesFactory<Box> Factory;
+typedef PDL::CompiledNetwork<Box> Rxn;
+typedef PDL::System<Box, Factory, Rxn> Sys;
+typedef PDL::IntervalGreensFunction G;
+
+int main (int argc, char ** argv)
+{
+	PDL::Random::seed (1);
+	std::mt19937 engine (1);
+
+	// the two series agree where they are switched, mean exit time 1/2,
+	// variance of the position of survivors
+	std::cerr << "S(1/4): " << G::survival (0.2499999) << " " << G::survival (0.25) << std::endl;
+	PDL::RunningStat exit, y2;
+	for (int i = 0; i < 100000; i++)
+	{
+		exit.push (G::exitTime (engine));
+		double y = G::position (0.01, engine);
+		y2.push (y * y);
+	}
+	std::cerr << "exit time: " << exit.mean () << " (0.5), <y^2> at s = 0.01: "
+		<< y2.mean () << " (0.02)" << std::endl;
+
+	// free diffusion far from absorbing walls, with small cubes to force exits
+	{
+		Box::Space x0 (0.), H (100.);
+		Box b (x0, H);
+		PDL::ReactionNetwork net;
+		int A = net.addSpecies ("A", 1.);
+		b.setBoundary (PDL::PDL_BOUNDARY_ABSORBING);
+		Factory F (net, 0.01);
+		Sys system (b, F);
+		Rxn rxn (net, F, b);
+		for (int i = 0; i < 4000; i++)
+			system.addParticle (x0, A);
+
+		PDL::GFRD<Sys, Rxn> gfrd (system, rxn);
+		gfrd.setMaxDomain (1.);
+		gfrd.advance (10.);
+		PDL::RunningStat r2;
+		for (int i = 0; i < system.getNParticles (); i++)
+			r2.push (system.particlePosition (i).two_norm2 ());
+		std::cerr << "MSD at t = 10: " << r2.mean () << " +- " << sqrt (r2.variance () / r2.count ())
+			<< " (60), ";
+		gfrd.print (&std::cerr);
+	}
+
+	// started within minDomain steps of an absorbing wall, at distance
+	// x0 = 0.3 (far from the others): Brownian steps, survival erf (x0 / sqrt (4 D t))
+	{
+		Box::Space x0 (0.), H (100.);
+		Box b (x0, H);
+		b.setBoundary (PDL::PDL_BOUNDARY_ABSORBING);
+		PDL::ReactionNetwork net;
+		int A = net.addSpecies ("A", 1.);
+		Factory F (net, 0.01);
+		Sys system (b, F);
+		Rxn rxn (net, F, b);
+		Box::Space y (0.);
+		y[0] = b.lower ()[0] + 0.3;
+		int N = 20000;
+		for (int i = 0; i < N; i++)
+			system.addParticle (y, A);
+
+		PDL::GFRD<Sys, Rxn> gfrd (system, rxn);
+		std::cerr << "near the wall:";
+		for (double t = 0.25; t < 1.1; t += 0.75)
+		{
+			gfrd.advance (t);
+			std::cerr << " survival at t = " << t << ": " << system.getNParticles () / (double) N
+				<< " +- " << sqrt (erf (0.3 / sqrt (4. * t)) * (1. - erf (0.3 / sqrt (4. * t))) / N)
+				<< " (" << erf (0.3 / sqrt (4. * t)) << ")";
+		}
+		std::cerr << ", ";
+		gfrd.print (&std::cerr);
+	}
+
+	// a gene in a micron sized box: birth and death of mRNA, exact rates
+	double km = 0.2, kdeg = 0.02, dt = 0.1, T = 20000.;
+	Box::Space x0 (0.), H (1.);
+	Box b (x0, H);
+	PDL::ReactionNetwork net;
+	int gene = net.addSpecies ("Gene", 0.);
+	int mrna = net.addSpecies ("mRNA", 1.);
+	net.produce (gene, mrna, km);
+	net.decay (mrna, kdeg);
+	Factory F (net, dt);
+
+	for (int mode = 0; mode < 2; mode++)
+	{
+		Sys system (b, F);
+		Rxn rxn (net, F, b);
+		system.addReaction (rxn);
+		system.addParticle (x0, gene);
+		PDL::GFRD<Sys, Rxn> gfrd (system, rxn);
+		PDL::EventJournal journal ("journal.bin");
+		if (mode)
+			system.setJournal (&journal);
+
+		PDL::RunningStat n, x;
+		auto start = std::chrono::steady_clock::now ();
+		for (double t = 10.; t <= T; t += 10.)
+		{
+			if (mode)
+				gfrd.advance (t);
+			else
+				while (system.time () + 0.5 * dt < t)
+					system.evolve (dt);
+			n.push (system.getNParticles (mrna));
+			for (int i = 0; i < system.getNParticles (); i++)
+				if (system.getParticle (i)->type () == mrna)
+					x.push (system.particlePosition (i)[0]);
+		}
+		double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+		// fixed steps realise the rates (1 - exp (- k dt)) / dt
+		double expected = mode ? km / kdeg : (1. - exp (- km * dt)) / (1. - exp (- kdeg * dt));
+		std::cerr << (mode ? "GFRD" : "BD") << ": mRNA " << n.mean () << " (" << expected << "), <x> "
+			<< x.mean () << " (0), <x^2> " << x.variance () << " (" << 1. / 12. << "), "
+			<< elapsed << " s" << std::endl;
+		if (mode)
+			gfrd.print (&std::cerr);
+
+		// events at their own times, in order, ending with the final number
+		if (mode)
+		{
+			journal.flush ();
+			PDL::JournalReader reader ("journal.bin");
+			unsigned long int disordered = 0, stamped = 0;
+			double last = 0.;
+			reader.forEach ([&] (const PDL::JournalEvent & e)
+				{
+					if (e.time < last)
+						disordered++;
+					if (fmod (e.time, 10.) == 0.)
+						stamped++;
+					last = e.time;
+				});
+			std::cerr << "journal: " << reader.nEvents () << " events, " << disordered << " out of order, "
+				<< stamped << " at the end of advance (), final mRNA " << reader.copyNumber (mrna).back ().second
+				<< " (" << system.getNParticles (mrna) << ")" << std::endl;
+			remove ("journal.bin");
+		}
+	}
+
+	return 1;
+}
@@ -0,0 +1,34 @@
+// instances.hh
+// the template instances compiled into libpdlib
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_INSTANCES_HH
+# define PDLIB_INSTANCES_HH
+
+// libpdlib (pdlib.cc) holds explicit instantiations of the geometries,
+// particles and systems below for each (ctype, dim) of PDL_INSTANCES.
+// With -DPDL_EXTERN_TEMPLATES (pdlib-config --cflags) the headers declare
+// them extern, so drivers do not compile them again but link to the
+// library (pdlib-config --libs); without it PDL stays header only.
+#define PDL_INSTANCES(M) M(double, 2) M(double, 3) M(float, 2) M(float, 3)
+
+#endif
@@ -0,0 +1,191 @@
+// configuration.hh
+// binary particle configurations (initial conditions, checkpoints)
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_IO_CONFIGURATION_HH
+# define PDLIB_IO_CONFIGURATION_HH
+
+#include <string>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#include <limits>
+#include <stdint.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <random>
+
+#include <dune/common/fvector.hh>
+
+namespace PDL
+{
+	// File layout: the header below, n particle types (int32_t, padded to
+	// 8 bytes) and n * dim coordinates of type ctype, all in native byte order
+	struct ConfigurationHeader
+	{
+		char magic[8]; // "PDLCONF"
+		int32_t dim;
+		int32_t csize; // sizeof (ctype)
+		uint64_t n;
+	};
+
+	// Read-only memory mapped configuration file
+	template<typename ctype, int dim>
+		class ConfigurationFile
+		{
+			public:
+				typedef typename Dune::FieldVector<ctype,dim>  Space;
+
+				ConfigurationFile (const std::string & fname) : base (nullptr), length (0)
+				{
+					int fd = open (fname.c_str(), O_RDONLY);
+					if (fd < 0)
+						throw std::runtime_error ("ConfigurationFile: cannot open " + fname);
+
+					struct stat st;
+					if (fstat (fd, &st) != 0)
+					{
+						close (fd);
+						throw std::runtime_error ("ConfigurationFile: cannot stat " + fname);
+					}
+					length = st.st_size;
+					if (length < sizeof (ConfigurationHeader))
+					{
+						close (fd);
+						throw std::runtime_error ("ConfigurationFile: " + fname + " is too short");
+					}
+					base = mmap (nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+					close (fd);
+					if (base == MAP_FAILED)
+						throw std::runtime_error ("ConfigurationFile: cannot map " + fname);
+					madvise (base, length, MADV_SEQUENTIAL);
+
+					// n is checked against the length before bytes (n), which
+					// could overflow
+					const ConfigurationHeader * h = static_cast<const ConfigurationHeader*> (base);
+					if (strncmp (h->magic, "PDLCONF", 8) != 0 || h->dim != dim || h->csize != sizeof (ctype)
+						|| h->n > (length - sizeof (ConfigurationHeader)) / (sizeof (int32_t) + dim * sizeof (ctype))
+						|| length < bytes (h->n))
+					{
+						munmap (base, length);
+						throw std::runtime_error ("ConfigurationFile: " + fname + " is not a matching configuration");
+					}
+					n = h->n;
+					types = reinterpret_cast<const int32_t*> (h + 1);
+					x = reinterpret_cast<const ctype*> (reinterpret_cast<const char*> (types) + padded (n));
+				};
+
+				~ConfigurationFile ()
+				{
+					if (base != nullptr)
+						munmap (base, length);
+				}
+
+				uint64_t size () const {return n;};
+				int type (uint64_t i) const {return types[i];};
+				Space position (uint64_t i) const
+				{
+					Space y;
+					for (int k = 0; k < dim; k++)
+						y[k] = x[i * dim + k];
+					return y;
+				}
+
+				static size_t padded (uint64_t n) {return ((n * sizeof (int32_t) + 7) / 8) * 8;};
+				static size_t bytes (uint64_t n)
+				{
+					return sizeof (ConfigurationHeader) + padded (n) + n * dim * sizeof (ctype);
+				}
+
+			private:
+				void * base;
+				size_t length;
+				uint64_t n;
+				const int32_t * types;
+				const ctype * x;
+
+				ConfigurationFile (const ConfigurationFile &);
+		};
+
+	// write types and positions of all particles of a system
+	template<class S>
+		void writeConfiguration (const S & system, const std::string & fname)
+		{
+			typedef typename S::Particle::Space Space;
+			typedef typename Space::field_type ctype;
+			const int dim = Space::dimension;
+
+			ConfigurationHeader h;
+			memset (&h, 0, sizeof (h));
+			strncpy (h.magic, "PDLCONF", 8);
+			h.dim = dim;
+			h.csize = sizeof (ctype);
+			h.n = system.getNParticles ();
+
+			std::ofstream stream (fname, std::ios::binary);
+			if (!stream)
+				throw std::runtime_error ("writeConfiguration: cannot open " + fname);
+			stream.write (reinterpret_cast<const char*> (&h), sizeof (h));
+			for (uint64_t i = 0; i < h.n; i++)
+			{
+				int32_t t = system.getParticle (i)->type ();
+				stream.write (reinterpret_cast<const char*> (&t), sizeof (t));
+			}
+			const char pad[8] = {0};
+			stream.write (pad, ConfigurationFile<ctype, dim>::padded (h.n) - h.n * sizeof (int32_t));
+			for (uint64_t i = 0; i < h.n; i++)
+			{
+				Space x = system.getParticle (i)->position ();
+				for (int k = 0; k < dim; k++)
+					stream.write (reinterpret_cast<const char*> (&x[k]), sizeof (ctype));
+			}
+			stream.close ();
+			if (!stream)
+				throw std::runtime_error ("writeConfiguration: cannot write " + fname);
+		}
+
+	// Load a configuration into a system with the bulk API; Type is the
+	// particle type argument of the factory (e.g., MinGenParticleType),
+	// further arguments are passed on to the factory
+	template<typename Type, class S, typename... Args>
+		int loadConfiguration (S & system, const std::string & fname, Args... args)
+		{
+			typedef typename S::Particle::Space Space;
+			typedef typename Space::field_type ctype;
+
+			ConfigurationFile<ctype, Space::dimension> file (fname);
+			if (file.size() > static_cast<uint64_t> (std::numeric_limits<int>::max()))
+				throw std::runtime_error ("loadConfiguration: too many particles in " + fname);
+			return system.addParticlesFrom (file.size(),
+				[&] (int i, typename S::FactoryType & f, std::mt19937 &) -> typename S::Particle *
+				{
+					return f.createParticle (file.position (i), static_cast<Type> (file.type (i)), args...);
+				});
+		}
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,388 @@
+// journal.hh
+// binary journal of births and deaths, with sparse keyframes
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_IO_JOURNAL_HH
+# define PDLIB_IO_JOURNAL_HH
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <limits>
+#include <cstring>
+#include <stdint.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace PDL
+{
+	typedef enum {PDL_EVENT_BIRTH, PDL_EVENT_DEATH, PDL_EVENT_ABSORB, PDL_EVENT_KEYFRAME, PDL_EVENT_SWITCH} JournalEventType;
+
+	// File layout: the header, then records in the order of events, all in
+	// native byte order. A record is a JournalEvent; a keyframe event (its
+	// particle field is the number of particles n) is followed by n
+	// JournalEntry's, each followed by dim coordinates (double). Particle
+	// numbers are 64 bit (version 2).
+	struct JournalHeader
+	{
+		char magic[8]; // "PDLJRNL"
+		int32_t dim;
+		int32_t version;
+	};
+
+	struct JournalEvent
+	{
+		double time;
+		int64_t particle; // number of the particle in its system
+		int32_t kind; // JournalEventType
+		int32_t type;
+		int32_t reaction; // -1 if not made or removed by a reaction; the new state of a switch
+		int32_t reserved;
+	};
+
+	struct JournalEntry
+	{
+		int64_t particle;
+		int32_t type;
+		int32_t reserved;
+	};
+
+	// Records the events of a System (see System::setJournal): births and
+	// deaths, with the reaction responsible, absorptions and switches of
+	// the internal state of a particle (which keeps its type), stamped with
+	// the end of the step they happened in. Positions are only stored in
+	// keyframes: when the journal is attached and then every so many steps
+	// (never if every = 0). The size of the file grows with the number of
+	// events, not steps.
+	class EventJournal
+	{
+		public:
+			EventJournal (const std::string & fname, int every = 0)
+				: stream (fname, std::ios::binary), every (every), steps (0), started (false)
+			{
+				if (!stream)
+					throw std::runtime_error ("EventJournal: cannot open " + fname);
+				buffer.reserve (capacity);
+			};
+
+			~EventJournal () {flush ();}
+
+			void record (JournalEventType kind, double time, int64_t particle, int type, int reaction = -1)
+			{
+				if (!started)
+					throw std::runtime_error ("EventJournal: events before the first keyframe");
+				JournalEvent e = {time, particle, kind, type, reaction, 0};
+				append (&e, sizeof (e));
+				if (buffer.size() >= capacity)
+					flush ();
+			}
+
+			// types, numbers and positions of all particles of a system
+			template<class S>
+			void keyframe (const S & system)
+			{
+				typedef typename S::Particle::Space Space;
+				const int dim = Space::dimension;
+				if (!started)
+				{
+					JournalHeader h;
+					memset (&h, 0, sizeof (h));
+					strncpy (h.magic, "PDLJRNL", 8);
+					h.dim = dim;
+					h.version = 2;
+					stream.write (reinterpret_cast<const char*> (&h), sizeof (h));
+					started = true;
+				}
+
+				JournalEvent e = {system.time (), system.getNParticles (), PDL_EVENT_KEYFRAME, -1, -1, 0};
+				append (&e, sizeof (e));
+				for (int i = 0; i < system.getNParticles (); i++)
+				{
+					const typename S::Particle * p = system.getParticle (i);
+					JournalEntry entry = {p->getNumber (), p->type (), 0};
+					append (&entry, sizeof (entry));
+					Space x = p->position ();
+					for (int k = 0; k < dim; k++)
+					{
+						double y = x[k];
+						append (&y, sizeof (y));
+					}
+				}
+				flush ();
+			}
+
+			// called by System::evolve after every step
+			template<class S>
+			void step (const S & system)
+			{
+				if (every > 0 && ++steps % every == 0)
+					keyframe (system);
+			}
+
+			void flush ()
+			{
+				stream.write (buffer.data(), buffer.size());
+				stream.flush ();
+				buffer.clear ();
+			}
+
+		private:
+			static const size_t capacity = 1 << 16;
+			std::ofstream stream;
+			std::vector<char> buffer;
+			const int every;
+			unsigned long int steps;
+			bool started;
+
+			void append (const void * data, size_t n)
+			{
+				const char * c = static_cast<const char*> (data);
+				buffer.insert (buffer.end(), c, c + n);
+			}
+
+			EventJournal (const EventJournal &);
+	};
+
+	// The state of a system rebuilt from a journal: particles alive at the
+	// time, with the positions of the preceding keyframe (NaN for those
+	// born after it), and the copy number of each type
+	struct JournalState
+	{
+		double time;
+		std::vector<int64_t> particle;
+		std::vector<int32_t> type;
+		std::vector<double> x; // dim per particle
+		std::vector<int> count;
+
+		int copyNumber (int type) const
+		{
+			return (type >= 0 && type < static_cast<int> (count.size())) ? count[type] : 0;
+		}
+	};
+
+	// Read-only memory mapped journal; a record cut short (e.g., the writer
+	// was killed) ends it
+	class JournalReader
+	{
+		public:
+			JournalReader (const std::string & fname) : base (nullptr), length (0), end (0), events (0)
+			{
+				int fd = open (fname.c_str(), O_RDONLY);
+				if (fd < 0)
+					throw std::runtime_error ("JournalReader: cannot open " + fname);
+
+				struct stat st;
+				fstat (fd, &st);
+				length = st.st_size;
+				if (length < sizeof (JournalHeader) + sizeof (JournalEvent))
+				{
+					close (fd);
+					throw std::runtime_error ("JournalReader: " + fname + " is too short");
+				}
+				base = mmap (nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+				close (fd);
+				if (base == MAP_FAILED)
+					throw std::runtime_error ("JournalReader: cannot map " + fname);
+				madvise (base, length, MADV_SEQUENTIAL);
+
+				const JournalHeader * h = static_cast<const JournalHeader*> (base);
+				if (strncmp (h->magic, "PDLJRNL", 8) != 0 || h->dim <= 0 || h->version != 2)
+				{
+					munmap (base, length);
+					throw std::runtime_error ("JournalReader: " + fname + " is not a journal");
+				}
+				dim = h->dim;
+
+				// index the keyframes
+				for (size_t o = sizeof (JournalHeader); o + sizeof (JournalEvent) <= length; )
+				{
+					const JournalEvent * e = event (o);
+					size_t next = o + sizeof (JournalEvent);
+					if (e->kind == PDL_EVENT_KEYFRAME)
+					{
+						next += e->particle * entrySize ();
+						if (next > length)
+							break;
+						keyframes.push_back (o);
+					}
+					else
+						events++;
+					end = next;
+					o = next;
+				}
+				if (keyframes.empty())
+				{
+					munmap (base, length);
+					throw std::runtime_error ("JournalReader: " + fname + " has no keyframe");
+				}
+			};
+
+			~JournalReader ()
+			{
+				if (base != nullptr)
+					munmap (base, length);
+			}
+
+			int dimension () const {return dim;};
+			unsigned long int nEvents () const {return events;};
+			int nKeyframes () const {return keyframes.size();};
+			double keyframeTime (int k) const {return event (keyframes.at (k))->time;};
+
+			// call f (const JournalEvent &) for all events (not keyframes) in order
+			template<class F>
+			void forEach (F f) const
+			{
+				for (size_t o = keyframes[0]; o < end; o = next (o))
+					if (event (o)->kind != PDL_EVENT_KEYFRAME)
+						f (*event (o));
+			}
+
+			// Exact trajectory of the copy number of a type: (time, number)
+			// from the first keyframe on, a point wherever the number changes
+			std::vector<std::pair<double, int> > copyNumber (int type) const
+			{
+				std::vector<std::pair<double, int> > n;
+				const JournalEvent * e = event (keyframes[0]);
+				int c = 0;
+				const JournalEntry * entry = reinterpret_cast<const JournalEntry*> (e + 1);
+				for (int i = 0; i < e->particle; i++, entry = next (entry))
+					if (entry->type == type)
+						c++;
+				n.push_back (std::make_pair (e->time, c));
+
+				forEach ([&] (const JournalEvent & e)
+					{
+						if (e.type != type || e.kind == PDL_EVENT_SWITCH)
+							return;
+						c += (e.kind == PDL_EVENT_BIRTH) ? 1 : -1;
+						if (n.back().first == e.time)
+							n.back().second = c;
+						else
+							n.push_back (std::make_pair (e.time, c));
+					});
+				return n;
+			}
+
+			// the state at time t: the last keyframe before t, and the events
+			// from there to t replayed
+			JournalState state (double t) const
+			{
+				int k = keyframes.size() - 1;
+				while (k > 0 && keyframeTime (k) > t)
+					k--;
+
+				JournalState s;
+				const JournalEvent * e = event (keyframes[k]);
+				std::unordered_map<int64_t, size_t> slot;
+				const JournalEntry * entry = reinterpret_cast<const JournalEntry*> (e + 1);
+				for (int i = 0; i < e->particle; i++, entry = next (entry))
+				{
+					slot[entry->particle] = s.particle.size();
+					s.particle.push_back (entry->particle);
+					s.type.push_back (entry->type);
+					const double * x = reinterpret_cast<const double*> (entry + 1);
+					s.x.insert (s.x.end(), x, x + dim);
+				}
+				s.time = e->time;
+
+				std::vector<bool> alive (s.particle.size(), true);
+				for (size_t o = next (keyframes[k]); o < end && event (o)->time <= t; o = next (o))
+				{
+					e = event (o);
+					if (e->kind == PDL_EVENT_KEYFRAME || e->kind == PDL_EVENT_SWITCH)
+						continue;
+					if (e->kind == PDL_EVENT_BIRTH)
+					{
+						slot[e->particle] = s.particle.size();
+						s.particle.push_back (e->particle);
+						s.type.push_back (e->type);
+						s.x.insert (s.x.end(), dim, std::numeric_limits<double>::quiet_NaN());
+						alive.push_back (true);
+					}
+					else
+					{
+						std::unordered_map<int64_t, size_t>::iterator i = slot.find (e->particle);
+						if (i != slot.end())
+						{
+							alive[i->second] = false;
+							slot.erase (i);
+						}
+					}
+					s.time = e->time;
+				}
+				if (t > s.time)
+					s.time = t;
+
+				// keep the living
+				size_t j = 0;
+				for (size_t i = 0; i < alive.size(); i++)
+					if (alive[i])
+					{
+						s.particle[j] = s.particle[i];
+						s.type[j] = s.type[i];
+						for (int d = 0; d < dim; d++)
+							s.x[j * dim + d] = s.x[i * dim + d];
+						if (s.type[j] >= static_cast<int> (s.count.size()))
+							s.count.resize (s.type[j] + 1, 0);
+						if (s.type[j] >= 0)
+							s.count[s.type[j]]++;
+						j++;
+					}
+				s.particle.resize (j);
+				s.type.resize (j);
+				s.x.resize (j * dim);
+				return s;
+			}
+
+		private:
+			void * base;
+			size_t length, end;
+			int dim;
+			unsigned long int events;
+			std::vector<size_t> keyframes; // offsets
+
+			size_t entrySize () const {return sizeof (JournalEntry) + dim * sizeof (double);};
+			const JournalEvent * event (size_t o) const
+			{
+				return reinterpret_cast<const JournalEvent*> (static_cast<const char*> (base) + o);
+			}
+			size_t next (size_t o) const
+			{
+				const JournalEvent * e = event (o);
+				return o + sizeof (JournalEvent) + ((e->kind == PDL_EVENT_KEYFRAME) ? e->particle * entrySize () : 0);
+			}
+			const JournalEntry * next (const JournalEntry * entry) const
+			{
+				return reinterpret_cast<const JournalEntry*> (reinterpret_cast<const char*> (entry) + entrySize ());
+			}
+
+			JournalReader (const JournalReader &);
+	};
+
+}; // namespace PDL
+
+#endif
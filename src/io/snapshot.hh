@@ -0,0 +1,259 @@
+// snapshot.hh
+// live snapshots of a system in shared memory
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_IO_SNAPSHOT_HH
+# define PDLIB_IO_SNAPSHOT_HH
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <new>
+#include <stdexcept>
+#include <cstring>
+#include <stdint.h>
+
+#include <pdlib/system.hh>
+#include <pdlib/parallel/shm.hh>
+
+namespace PDL
+{
+	// Layout of the segment: the header, then nslots slots of slotSize bytes,
+	// each a SnapshotSlot, capacity particle types (int32_t, padded to 8
+	// bytes) and capacity * dim coordinates of type ctype
+	struct SnapshotHeader
+	{
+		char magic[8]; // "PDLSNAP"
+		int32_t dim;
+		int32_t csize; // sizeof (ctype)
+		uint64_t nslots;
+		uint64_t capacity;
+		uint64_t slotSize;
+		alignas(64) std::atomic<uint64_t> latest; // number of the last snapshot + 1
+	};
+
+	struct SnapshotSlot
+	{
+		alignas(64) std::atomic<uint64_t> seq; // odd while being written
+		uint64_t number; // snapshots published before this one
+		double time;
+		uint64_t n; // particles in the system
+		uint64_t stored; // particles in the slot, min (n, capacity)
+		SystemCounters counters;
+	};
+
+	// A snapshot as seen by a reader, pointing into the shared memory
+	template<typename ctype>
+		struct SnapshotView
+		{
+			uint64_t number;
+			double time;
+			uint64_t n, stored;
+			SystemCounters counters;
+			const int32_t * types;
+			const ctype * x; // stored * dim coordinates
+		};
+
+	// Publishes snapshots of a system (time, counters, types and positions)
+	// into a named POSIX shared memory ring of nslots slots, protected by
+	// sequence locks: the writer never waits for readers, readers never
+	// block the writer and only retry if the writer lapped the ring while
+	// they were reading. Publishing costs one pass over the particles.
+	//
+	// As an observer (addObserver), a snapshot is published every so many
+	// steps. Systems larger than capacity are stored truncated (stored < n).
+	template<typename ctype, int dim>
+		class SnapshotWriter
+		{
+			public:
+				SnapshotWriter (const std::string & name, uint64_t capacity, int every = 1, int nslots = 4)
+					: shm (name, bytes (capacity, nslots)), every (every), calls (0)
+				{
+					base = static_cast<char*> (shm.data());
+					h = new (base) SnapshotHeader;
+					strncpy (h->magic, "PDLSNAP", 8);
+					h->dim = dim;
+					h->csize = sizeof (ctype);
+					h->nslots = nslots;
+					h->capacity = capacity;
+					h->slotSize = slotSize (capacity);
+					for (int k = 0; k < nslots; k++)
+						new (slot (k)) SnapshotSlot;
+					h->latest.store (0, std::memory_order_release);
+				};
+
+				template<class S>
+				void publish (const S & system)
+				{
+					uint64_t number = h->latest.load (std::memory_order_relaxed);
+					SnapshotSlot * s = slot (number % h->nslots);
+					uint64_t seq = s->seq.load (std::memory_order_relaxed);
+					s->seq.store (seq + 1, std::memory_order_relaxed);
+					std::atomic_thread_fence (std::memory_order_release);
+
+					s->number = number;
+					s->time = system.time ();
+					s->n = system.getNParticles ();
+					s->stored = std::min<uint64_t> (s->n, h->capacity);
+					s->counters = system.getCounters ();
+					int32_t * types = reinterpret_cast<int32_t*> (s + 1);
+					ctype * x = reinterpret_cast<ctype*> (reinterpret_cast<char*> (types) + padded (h->capacity));
+					for (uint64_t i = 0; i < s->stored; i++)
+					{
+						const typename S::Particle * p = system.getParticle (i);
+						types[i] = p->type ();
+						typename S::Particle::Space y = p->position ();
+						for (int k = 0; k < dim; k++)
+							x[i * dim + k] = y[k];
+					}
+
+					s->seq.store (seq + 2, std::memory_order_release);
+					h->latest.store (number + 1, std::memory_order_release);
+				}
+
+				// snapshots published so far
+				uint64_t published () const {return h->latest.load (std::memory_order_relaxed);};
+
+				// observer interface
+				template<class S>
+				void sample (const S & system)
+				{
+					if (++calls % every == 0)
+						publish (system);
+				}
+
+				static size_t padded (uint64_t n) {return ((n * sizeof (int32_t) + 7) / 8) * 8;};
+				static size_t slotSize (uint64_t capacity)
+				{
+					size_t b = sizeof (SnapshotSlot) + padded (capacity) + capacity * dim * sizeof (ctype);
+					return (b + 63) / 64 * 64;
+				}
+				static size_t bytes (uint64_t capacity, int nslots)
+				{
+					return sizeof (SnapshotHeader) + nslots * slotSize (capacity);
+				}
+
+			private:
+				SharedMemory shm;
+				char * base;
+				SnapshotHeader * h;
+				const int every;
+				unsigned long int calls;
+
+				SnapshotSlot * slot (uint64_t k)
+				{
+					return reinterpret_cast<SnapshotSlot*> (base + sizeof (SnapshotHeader) + k * h->slotSize);
+				}
+
+				SnapshotWriter (const SnapshotWriter &);
+		};
+
+	// Attaches read-only to the snapshots of a writer (in any local process)
+	template<typename ctype, int dim>
+		class SnapshotReader
+		{
+			public:
+				SnapshotReader (const std::string & name) : shm (name)
+				{
+					base = static_cast<const char*> (shm.data());
+					h = reinterpret_cast<const SnapshotHeader*> (base);
+					if (shm.size () < sizeof (SnapshotHeader) || strncmp (h->magic, "PDLSNAP", 8) != 0
+						|| h->dim != dim || h->csize != sizeof (ctype)
+						|| shm.size () < sizeof (SnapshotHeader) + h->nslots * h->slotSize)
+						throw std::runtime_error ("SnapshotReader: " + name + " is not a matching snapshot ring");
+				};
+
+				// snapshots published so far
+				uint64_t published () const {return h->latest.load (std::memory_order_acquire);};
+
+				// Call f (const SnapshotView<ctype> &) on the latest snapshot,
+				// in place. Returns false if there is none yet, or if the writer
+				// overwrote it meanwhile: then whatever f saw may be torn and
+				// must be discarded (read again).
+				template<class F>
+				bool read (F f) const
+				{
+					uint64_t latest = published ();
+					if (latest == 0)
+						return false;
+					const SnapshotSlot * s = slot ((latest - 1) % h->nslots);
+					uint64_t seq = s->seq.load (std::memory_order_acquire);
+					if (seq % 2)
+						return false;
+
+					SnapshotView<ctype> v;
+					v.number = s->number;
+					v.time = s->time;
+					v.n = s->n;
+					v.stored = std::min<uint64_t> (s->stored, h->capacity);
+					v.counters = s->counters;
+					v.types = reinterpret_cast<const int32_t*> (s + 1);
+					v.x = reinterpret_cast<const ctype*> (reinterpret_cast<const char*> (v.types) + padded (h->capacity));
+					f (v);
+
+					std::atomic_thread_fence (std::memory_order_acquire);
+					return s->seq.load (std::memory_order_relaxed) == seq;
+				}
+
+				// copy the latest snapshot, retrying until it is consistent;
+				// false if there is none, or after attempts failures (e.g.,
+				// the writer died while writing the slot)
+				bool copy (SnapshotView<ctype> & v, std::vector<int32_t> & types, std::vector<ctype> & x,
+					long int attempts = 1000000) const
+				{
+					if (published () == 0)
+						return false;
+					for (long int a = 0; !read ([&] (const SnapshotView<ctype> & s)
+						{
+							v = s;
+							types.assign (s.types, s.types + s.stored);
+							x.assign (s.x, s.x + s.stored * dim);
+						}); a++)
+					{
+						if (a + 1 >= attempts)
+							return false;
+						std::this_thread::yield ();
+					}
+					v.types = types.data();
+					v.x = x.data();
+					return true;
+				}
+
+			private:
+				SharedMemory shm;
+				const char * base;
+				const SnapshotHeader * h;
+
+				static size_t padded (uint64_t n) {return ((n * sizeof (int32_t) + 7) / 8) * 8;};
+				const SnapshotSlot * slot (uint64_t k) const
+				{
+					return reinterpret_cast<const SnapshotSlot*> (base + sizeof (SnapshotHeader) + k * h->slotSize);
+				}
+
+				SnapshotReader (const SnapshotReader &);
+		};
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,109 @@
+/* testConfiguration.cc  2015-07-24 test bulk insertion and binary configurations
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstddef>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/io/configuration.hh>
+
+typedef PDL::GeometryBox<double, 3> Box;
+
+// more particles close to the centre
+class Gauss
+{
+	public:
+		double operator() (const Box::Space & x) const {return exp (- x.two_norm2 ());};
+};
+
+int main (int argc, char ** argv) 
+{
+	Box::Space x0 (0.), H (4.);
+	Box b (x0, H);
+
+	PDL::ReactionNetwork net;
+	int A = net.addSpecies ("A", 1.);
+	int B = net.addSpecies ("B", 0.1);
+
+	typedef PDL::SpeciesFactory<Box> Factory;
+	Factory F (net, 0.01);
+
+	PDL::System<Box, Factory> system (b, F);
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	system.addParticles (100000, A);
+	system.addParticlesWithDensity (100000, Gauss (), 1., B);
+	std::cerr << system.getNParticles (A) << " A and " << system.getNParticles (B) << " B inserted in "
+		<< std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count () << " s" << std::endl;
+
+	PDL::writeConfiguration (system, "configuration.bin");
+
+	PDL::System<Box, Factory> copy (b, F);
+	PDL::loadConfiguration<int> (copy, "configuration.bin");
+	std::cerr << copy.getNParticles (A) << " A and " << copy.getNParticles (B) << " B loaded" << std::endl;
+
+	double r2 = 0.;
+	for (int i = 0; i < copy.getNParticles(); i++)
+		if (copy.getParticle(i)->type() == B)
+			r2 += copy.getParticle(i)->position().two_norm2();
+	std::cerr << "<r^2> of B: " << r2 / copy.getNParticles (B) << " (1.43 for the Gaussian truncated by the box)" << std::endl;
+
+	// a header claiming more particles than the file holds, and a file that
+	// cannot be written, are refused
+	{
+		std::fstream f ("configuration.bin", std::ios::binary | std::ios::in | std::ios::out);
+		f.seekp (offsetof (PDL::ConfigurationHeader, n));
+		uint64_t n = ~static_cast<uint64_t> (0) / 4;
+		f.write (reinterpret_cast<const char*> (&n), sizeof (n));
+	}
+	int refused = 0;
+	try {PDL::ConfigurationFile<double, 3> file ("configuration.bin");}
+	catch (std::runtime_error & e) {refused++;}
+	try {PDL::writeConfiguration (system, "/nonexistent/configuration.bin");}
+	catch (std::runtime_error & e) {refused++;}
+	std::cerr << "bad files refused: " << refused << " of 2" << std::endl;
+	remove ("configuration.bin");
+
+	// with the same seed bulk insertion gives the same particles (also with
+	// OpenMP), down to their random engines
+	PDL::System<Box, Factory> * s[2];
+	for (int k = 0; k < 2; k++)
+	{
+		PDL::Random::seed (7);
+		s[k] = new PDL::System<Box, Factory> (b, F);
+		s[k]->addParticles (50000, A);
+		s[k]->addParticlesWithDensity (50000, Gauss (), 1., B);
+	}
+	int differ = (s[0]->getNParticles () != s[1]->getNParticles ());
+	for (int i = 0; !differ && i < s[0]->getNParticles (); i++)
+	{
+		Factory::Particle * p = s[0]->getParticle (i), * q = s[1]->getParticle (i);
+		if (p->type () != q->type () || (p->position () - q->position ()).two_norm () != 0.
+			|| p->randomEngine () () != q->randomEngine () ())
+			differ++;
+	}
+	std::cerr << "seeded insertion twice: " << s[0]->getNParticles () << " particles, "
+		<< (differ ? "differ" : "identical") << std::endl;
+	delete s[0];
+	delete s[1];
+
+	return 1;
+}
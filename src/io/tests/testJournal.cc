@@ -0,0 +1,196 @@
+/* testJournal.cc  2015-08-19 copy numbers rebuilt from an event journal
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <set>
+#include <map>
+#include <chrono>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/io/journal.hh>
+#include <pdlib/mingen/mingen.hh>
+
+typedef PDL::GeometryBox<double, 3> Box;
+typedef PDL::SpeciesFactory<Box> Factory;
+typedef PDL::CompiledNetwork<Box> Rxn;
+typedef PDL::System<Box, Factory, Rxn> Sys;
+
+int main (int argc, char ** argv)
+{
+	PDL::Random::seed (1);
+
+	// a switching gene, mRNA degraded or lost through the walls
+	Box::Space x0 (0.), H (3.);
+	Box b (x0, H);
+	b.setBoundary (PDL::PDL_BOUNDARY_ABSORBING);
+	double dt = 0.01;
+	int nsteps = 20000, keyframes = 5000, probe = 12345;
+	PDL::ReactionNetwork net;
+	int off = net.addSpecies ("GeneOff", 0.);
+	int on = net.addSpecies ("GeneOn", 0.);
+	int mrna = net.addSpecies ("mRNA", 0.1);
+	int switchOn = net.convert (off, on, 0.05);
+	net.convert (on, off, 0.05);
+	net.produce (on, mrna, 2.);
+	net.decay (mrna, 0.05);
+	Factory F (net, dt);
+
+	Sys system (b, F);
+	system.addReaction (Rxn (net, F, b));
+	for (int i = 0; i < 10; i++)
+		system.addParticle (x0, off);
+
+	const std::string fname = "journal.bin";
+	std::vector<std::vector<int> > sampled (net.nSpecies ());
+	std::set<int64_t> alive;
+	std::vector<double> positions;
+	double elapsed[2];
+	for (int journaled = 0; journaled < 2; journaled++)
+	{
+		Sys s (system);
+		PDL::EventJournal journal (fname, keyframes);
+		if (journaled)
+			s.setJournal (&journal);
+		auto start = std::chrono::steady_clock::now ();
+		for (int k = 1; k <= nsteps; k++)
+		{
+			s.evolve (dt);
+			if (!journaled)
+				continue;
+			for (int type = 0; type < net.nSpecies (); type++)
+				sampled[type].push_back (s.getNParticles (type));
+			if (k == probe)
+				for (int i = 0; i < s.getNParticles (); i++)
+					alive.insert (s.getParticle (i)->getNumber ());
+			if (k == 2 * keyframes)
+				for (int i = 0; i < s.getNParticles (); i++)
+					for (int d = 0; d < 3; d++)
+						positions.push_back (s.particlePosition (i)[d]);
+		}
+		elapsed[journaled] = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+	}
+
+	// the step functions agree with the numbers sampled after every step
+	PDL::JournalReader reader (fname);
+	int differ = 0;
+	for (int type = 0; type < net.nSpecies (); type++)
+	{
+		std::vector<std::pair<double, int> > n = reader.copyNumber (type);
+		unsigned int j = 0;
+		for (int k = 0; k < nsteps; k++)
+		{
+			double t = (k + 1) * dt;
+			while (j + 1 < n.size() && n[j + 1].first <= t + 0.5 * dt)
+				j++;
+			if (n[j].second != sampled[type][k])
+				differ++;
+		}
+	}
+
+	// gene switches are the events of their reaction
+	unsigned long int switches = 0, absorbed = 0;
+	reader.forEach ([&] (const PDL::JournalEvent & e)
+		{
+			if (e.reaction == switchOn && e.kind == PDL::PDL_EVENT_BIRTH)
+				switches++;
+			if (e.kind == PDL::PDL_EVENT_ABSORB)
+				absorbed++;
+		});
+
+	// replayed state: the same particles, positions at a keyframe
+	PDL::JournalState s = reader.state (probe * dt + 0.5 * dt);
+	std::set<int64_t> replayed (s.particle.begin(), s.particle.end());
+	PDL::JournalState k = reader.state (2 * keyframes * dt + 0.5 * dt);
+	bool placed = (k.x == positions);
+
+	std::cerr << reader.nEvents () << " events, " << reader.nKeyframes () << " keyframes, "
+		<< switches << " switches on, " << absorbed << " absorbed" << std::endl;
+	std::cerr << "copy numbers: " << differ << " of " << nsteps * net.nSpecies () << " differ; state at t = "
+		<< s.time << ": " << s.copyNumber (mrna) << " mRNA (" << sampled[mrna][probe - 1] << "), particles "
+		<< (replayed == alive ? "match" : "differ") << ", keyframe positions " << (placed ? "match" : "differ")
+		<< std::endl;
+	std::cerr << "journal with " << nsteps << " steps: " << elapsed[1] << " s against " << elapsed[0] << " s" << std::endl;
+	remove (fname.c_str());
+
+	// numbers beyond 32 bit (e.g., strided across many slabs) are kept
+	{
+		Sys big (b, F);
+		big.addReaction (Rxn (net, F, b));
+		big.setNumbering (static_cast<int64_t> (1) << 33, 1000);
+		for (int i = 0; i < 10; i++)
+			big.addParticle (x0, on);
+		PDL::EventJournal journal (fname);
+		big.setJournal (&journal);
+		for (int k = 0; k < 1000; k++)
+			big.evolve (dt);
+		journal.flush ();
+		PDL::JournalReader r (fname);
+		PDL::JournalState last = r.state (big.time ());
+		std::set<int64_t> numbers;
+		for (int i = 0; i < big.getNParticles (); i++)
+			numbers.insert (big.getParticle (i)->getNumber ());
+		std::cerr << "64 bit numbers: replayed particles "
+			<< (std::set<int64_t> (last.particle.begin(), last.particle.end()) == numbers ? "match" : "differ")
+			<< ", smallest " << *numbers.begin () << std::endl;
+		remove (fname.c_str());
+	}
+
+	// MinGen genes switch on and off inside: the switches replayed from
+	// the journal give the state of every gene
+	{
+		typedef PDL::GeometryBox<double, 2> Box2;
+		typedef PDL::System<Box2, MinGenFactory<Box2>, MinGenReaction<Box2> > MinGenSys;
+		Box2::Space y0 (0.), L (2.);
+		Box2 b2 (y0, L);
+		MinGenFactory<Box2> G (0.05, 0.05, 0.02, 0.2, 0.01, dt, 0.001);
+		MinGenSys s (b2, G);
+		s.addReaction (MinGenReaction<Box2> (G));
+		for (int i = 0; i < 10; i++)
+			s.addParticle (y0, MINGEN_GENE);
+		PDL::EventJournal journal (fname);
+		s.setJournal (&journal);
+		for (int k = 0; k < 2000; k++)
+			s.evolve (dt);
+		journal.flush ();
+
+		std::map<int64_t, int> state;
+		unsigned long int switches = 0;
+		PDL::JournalReader r (fname);
+		r.forEach ([&] (const PDL::JournalEvent & e)
+			{
+				if (e.kind == PDL::PDL_EVENT_SWITCH)
+				{
+					state[e.particle] = e.reaction;
+					switches++;
+				}
+			});
+		int wrong = 0;
+		for (int i = 0; i < s.getNParticles (); i++)
+			if (s.getParticle (i)->type () == MINGEN_GENE && state[s.getParticle (i)->getNumber ()] != s.getParticle (i)->state ())
+				wrong++;
+		std::cerr << "gene switches: " << switches << " (about " << 10 * 2000 * dt * 0.05 << "), "
+			<< wrong << " of 10 genes in the wrong state, " << r.copyNumber (MINGEN_MRNA).back ().second
+			<< " mRNA (" << s.getNParticles (MINGEN_MRNA) << ")" << std::endl;
+		remove (fname.c_str());
+	}
+
+	return 1;
+}
@@ -0,0 +1,179 @@
+/* testSnapshot.cc  2015-08-18 live snapshots read by another process
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <chrono>
+
+#include <sys/wait.h>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/io/snapshot.hh>
+
+typedef PDL::GeometryBox<double, 3> Box;
+typedef PDL::SpeciesFactory<Box> Factory;
+typedef PDL::CompiledNetwork<Box> Rxn;
+typedef PDL::SnapshotWriter<double, 3> Writer;
+typedef PDL::SnapshotReader<double, 3> Reader;
+typedef PDL::System<Box, Factory, Rxn, Writer> Sys;
+
+int main (int argc, char ** argv)
+{
+	PDL::Random::seed (1);
+
+	Box::Space x0 (0.), H (5.);
+	Box b (x0, H);
+	double dt = 0.01;
+	PDL::ReactionNetwork net;
+	int gene = net.addSpecies ("Gene", 0.);
+	int mrna = net.addSpecies ("mRNA", 1.);
+	net.produce (gene, mrna, 1.);
+	net.decay (mrna, 0.01);
+	Factory F (net, dt);
+
+	std::mt19937 engine (2);
+	Sys system (b, F);
+	system.addReaction (Rxn (net, F, b));
+	for (int i = 0; i < 20; i++)
+		system.addParticle (b.randomPoint (engine), gene);
+	for (int i = 0; i < 2000; i++)
+		system.addParticle (b.randomPoint (engine), mrna);
+
+	const std::string name = "/pdlib-test-snapshot";
+	const int nsteps = 5000;
+
+	// the writer stores what it was given
+	{
+		Writer w (name, 4000);
+		for (int k = 0; k < 10; k++)
+			system.evolve (dt);
+		w.publish (system);
+		Reader r (name);
+		PDL::SnapshotView<double> v;
+		std::vector<int32_t> types;
+		std::vector<double> x;
+		if (!r.copy (v, types, x) || v.n != static_cast<uint64_t> (system.getNParticles ()) || v.stored != v.n
+			|| v.time != system.time () || v.counters.steps != system.getCounters ().steps)
+			std::cerr << "header differs" << std::endl;
+		int differ = 0;
+		for (unsigned int i = 0; i < v.stored; i++)
+		{
+			Box::Space y = system.particlePosition (i);
+			if (types[i] != system.getParticle (i)->type () || x[3 * i] != y[0]
+				|| x[3 * i + 1] != y[1] || x[3 * i + 2] != y[2])
+				differ++;
+		}
+		std::cerr << "in process: " << v.n << " particles, " << differ << " differ" << std::endl;
+	}
+
+	// a writer killed while writing leaves the slot odd: copy gives up
+	{
+		Writer w (name, 4000);
+		w.publish (system);
+		int fd = shm_open (name.c_str (), O_RDWR, 0);
+		void * base = mmap (nullptr, sizeof (PDL::SnapshotHeader) + sizeof (PDL::SnapshotSlot),
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close (fd);
+		PDL::SnapshotSlot * slot = reinterpret_cast<PDL::SnapshotSlot*> (static_cast<char*> (base) + sizeof (PDL::SnapshotHeader));
+		slot->seq.fetch_add (1);
+		Reader r (name);
+		PDL::SnapshotView<double> v;
+		std::vector<int32_t> types;
+		std::vector<double> x;
+		std::cerr << "slot left odd: copy " << (r.copy (v, types, x, 1000) ? "succeeded" : "gave up") << std::endl;
+		munmap (base, sizeof (PDL::SnapshotHeader) + sizeof (PDL::SnapshotSlot));
+	}
+
+	// the cost of publishing every step, against evolving alone
+	Writer w (name, 4000, 1);
+	double elapsed[2];
+	for (int observed = 0; observed < 2; observed++)
+	{
+		Sys s (system);
+		if (observed)
+			s.addObserver (&w);
+		auto start = std::chrono::steady_clock::now ();
+		for (int k = 0; k < nsteps; k++)
+			s.evolve (dt);
+		elapsed[observed] = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+	}
+	std::cerr << "publishing every step: " << elapsed[1] << " s against " << elapsed[0] << " s" << std::endl;
+
+	// a viewer in another process attaches and polls while the system evolves
+	system.addObserver (&w);
+	uint64_t first = w.published ();
+	pid_t pid = fork ();
+	if (pid == 0)
+	{
+		Reader r (name);
+		unsigned long int valid = 0, torn = 0, bad = 0;
+		uint64_t last = 0;
+		double tlast = -1.;
+		while (last < first + nsteps)
+		{
+			usleep (100);
+			uint64_t number = 0;
+			double t = 0.;
+			bool consistent = true;
+			if (r.read ([&] (const PDL::SnapshotView<double> & v)
+				{
+					number = v.number;
+					t = v.time;
+					unsigned long int genes = 0;
+					for (uint64_t i = 0; i < v.stored; i++)
+					{
+						if (v.types[i] == gene)
+							genes++;
+						for (int k = 0; k < 3; k++)
+							if (!(v.x[3 * i + k] >= -5. && v.x[3 * i + k] <= 5.))
+								consistent = false;
+					}
+					if (genes != 20)
+						consistent = false;
+				}))
+			{
+				if (number < first || number + 1 == last)
+					continue;
+				valid++;
+				if (!consistent || t < tlast)
+					bad++;
+				last = number + 1;
+				tlast = t;
+			}
+			else
+				torn++;
+		}
+		std::cerr << "viewer: " << valid << " snapshots read, " << torn << " retried, "
+			<< bad << " inconsistent" << std::endl;
+		_exit (bad ? 1 : 0);
+	}
+
+	for (int k = 0; k < nsteps; k++)
+		system.evolve (dt);
+	int status;
+	waitpid (pid, &status, 0);
+
+	const PDL::SystemCounters & c = system.getCounters ();
+	std::cerr << "counters: " << c.steps << " steps, " << c.born << " born, " << c.reacted
+		<< " reacted, " << c.absorbed << " absorbed, " << c.seconds << " s, viewer "
+		<< (WIFEXITED (status) && WEXITSTATUS (status) == 0 ? "ok" : "failed") << std::endl;
+
+	return 1;
+}
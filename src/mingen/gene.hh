@@ -48,44 +48,11 @@ namespace PDL
 				{};
 
 				// for a Gene move() means switch state
-				bool move (double dt)
-				{
-					//PDL_WARNING (dt < tOff || dt < tOn, "time step smaller than the average switch times");
-
-					time += dt;
-					if (GeneOn)
-					{
-						timeOn += dt;
-						if (switchOff (dt))
-							Km = Kmbasal;
-					}
-					else
-					{
-						timeOff += dt;
-						if (switchOn (dt))
-							Km = Kmon;
-					}
-					return true;
-
-				}
+				bool move (double dt);
 
 				// this does not create mRNA, but tells if the Gene is ready to create it
 				// FIXME: create mRNA here?
-				bool mRNA (double dt)
-				{
-					//PDL_WARNING (dt < tMRNA, "time step smaller than the average mRNA production time");
-					
-					double r = (rand()/(double)(RAND_MAX));
-					//std::cerr << "Gene ON: " << GeneOn << " Km=" << Km << std::endl;
-					double prob = 1. - exp (- Km * dt);
-					if (r < prob)
-					{
-						NmRNA++;
-						return true;
-					}
-
-					return false;
-				}
+				bool mRNA (double dt);
 
 				PDL::MinGen::mRNA<Geometry> *  mRNA (double dt, double D, double kdeg)
 				{
@@ -98,6 +65,8 @@ namespace PDL
 
 				const Space & position (void) const {return X;};
 
+				bool isOn (void) const {return GeneOn;};
+
 				void printStat (std::ostream * stream) const 
 				{
 					*stream << "*** Gene Position: " << X << " ***" << std::endl;
@@ -117,7 +86,7 @@ namespace PDL
 			private:
 
 				double time; // total time
-				const Space & X;
+				const Space X;
 
 				//
 				// Gene state
@@ -138,41 +107,90 @@ namespace PDL
 				unsigned long int NmRNA; // number of mRNA created (for stat)
 
 				// Switch on/off
-				bool switchOn (double dt)
-				{
+				bool switchOn (double dt);
 
-					if (!GeneOn)
-					{
-						double r = (rand()/(double)(RAND_MAX));
-						double prob = 1. - exp (- Kon * dt);
-
-						if (r < prob)
-						{
-							GeneOn = true;
-							return true; // we switched
-						}
-					}
-					
-					return false; // we did not switch
-				}
+				bool switchOff (double dt);
+		};
 
-				bool switchOff (double dt)
+		template<class Geometry>
+		bool Gene<Geometry>::move (double dt)
+		{
+			//PDL_WARNING (dt < tOff || dt < tOn, "time step smaller than the average switch times");
+
+			time += dt;
+			if (GeneOn)
+			{
+				timeOn += dt;
+				if (switchOff (dt))
+					Km = Kmbasal;
+			}
+			else
+			{
+				timeOff += dt;
+				if (switchOn (dt))
+					Km = Kmon;
+			}
+			return true;
+
+		}
+
+		template<class Geometry>
+		bool Gene<Geometry>::mRNA (double dt)
+		{
+			//PDL_WARNING (dt < tMRNA, "time step smaller than the average mRNA production time");
+			
+			double r = (rand()/(double)(RAND_MAX));
+			//std::cerr << "Gene ON: " << GeneOn << " Km=" << Km << std::endl;
+			double prob = 1. - exp (- Km * dt);
+			if (r < prob)
+			{
+				NmRNA++;
+				return true;
+			}
+
+			return false;
+		}
+
+		template<class Geometry>
+		bool Gene<Geometry>::switchOn (double dt)
+		{
+
+			if (!GeneOn)
+			{
+				double r = (rand()/(double)(RAND_MAX));
+				double prob = 1. - exp (- Kon * dt);
+
+				if (r < prob)
 				{
-					if (GeneOn)
-					{
-						double r = (rand()/(double)(RAND_MAX));
-						double prob = 1. - exp (- Koff * dt);
-						if (r < prob)
-						{
-							GeneOn = false;
-							return true; // we switched
-						}
-					}
-					return false; // we did not switch
+					GeneOn = true;
+					return true; // we switched
 				}
+			}
+			
+			return false; // we did not switch
+		}
 
-
-		};
+		template<class Geometry>
+		bool Gene<Geometry>::switchOff (double dt)
+		{
+			if (GeneOn)
+			{
+				double r = (rand()/(double)(RAND_MAX));
+				double prob = 1. - exp (- Koff * dt);
+				if (r < prob)
+				{
+					GeneOn = false;
+					return true; // we switched
+				}
+			}
+			return false; // we did not switch
+		}
+
+#ifdef PDL_EXTERN_TEMPLATES
+#define PDL_EXTERN(ctype, dim) extern template class Gene<GeometryBox<ctype, dim> >;
+		PDL_INSTANCES (PDL_EXTERN)
+#undef PDL_EXTERN
+#endif
 
 	}; // namespace MinGen
 }; // namespace PDL
@@ -43,21 +43,30 @@ namespace PDL
 					kdeg (kdeg) {};
 
 				// This does NOT delete mRNA, but tells if it is ready to degrade by returning true
-				bool degrade (double dt)
-				{
-					//PDL_WARNING (dt < tdeg, "time step smaller than the rate degradation constant");
-					double r = rand()/((double)(RAND_MAX));
-					double prob = 1. - exp (- kdeg * dt);
-					if (r < prob)
-						return true; // I will be deleted by the system as I leave the list empty
-					return false;
-				}
+				bool degrade (double dt);
 
 			private:
 				const double kdeg;
 
 		};
 
+		template<class Geometry>
+		bool mRNA<Geometry>::degrade (double dt)
+		{
+			//PDL_WARNING (dt < tdeg, "time step smaller than the rate degradation constant");
+			double r = rand()/((double)(RAND_MAX));
+			double prob = 1. - exp (- kdeg * dt);
+			if (r < prob)
+				return true; // I will be deleted by the system as I leave the list empty
+			return false;
+		}
+
+#ifdef PDL_EXTERN_TEMPLATES
+#define PDL_EXTERN(ctype, dim) extern template class mRNA<GeometryBox<ctype, dim> >;
+		PDL_INSTANCES (PDL_EXTERN)
+#undef PDL_EXTERN
+#endif
+
 	}; // namespace MinGen
 }; // namespace PDL
 
@@ -17,8 +17,17 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  */
 
+#ifndef PDLIB_MINGEN_MINGEN_HH
+# define PDLIB_MINGEN_MINGEN_HH
+
 #include <pdlib/mingen/mRNA.hh>
 #include <pdlib/mingen/gene.hh>
+#include <pdlib/instances.hh>
+#ifdef PDL_EXTERN_TEMPLATES
+#include <pdlib/geom/box.hh>
+#include <pdlib/system.hh>
+#include <pdlib/observables/observables.hh>
+#endif
 #include <vector>
 
 typedef enum {MINGEN_MRNA, MINGEN_GENE} MinGenParticleType;
@@ -36,14 +45,16 @@ class MinGenParticle
 		MinGenParticle (const Space & x, double D, double dt, double kdeg)
 			: _type(MINGEN_MRNA), m (x, D, dt, kdeg), number (0) {};
 
-		bool move (double dt, Geometry geo)
+		// a gene does not move (it is in the static tier of the system) and
+		// switches its state in MinGenReaction
+		bool move (double dt, Geometry & geo)
 		{
 			switch (_type)
 			{
 				case MINGEN_MRNA: m.move(dt, geo);
 					return true;
 
-				case MINGEN_GENE: g.move (dt);
+				case MINGEN_GENE:
 					return true;
 
 				default:
@@ -66,11 +77,40 @@ class MinGenParticle
 			}
 		};
 
-		void setNumber (int n)
+		// mRNA may leave the system through an absorbing boundary
+		bool absorbed (void) const
+		{
+			if (_type == MINGEN_MRNA)
+				return m.absorbed();
+
+			return false;
+		};
+
+		void setNumber (int64_t n)
 		{
 			number = n;
 		}
 
+		int64_t getNumber (void) const {return number;};
+
+		bool immobile (void) const {return _type == MINGEN_GENE;};
+
+		// a gene is on (1) or off (0), switches are journaled by the system
+		int state (void) const
+		{
+			if (_type == MINGEN_GENE)
+				return g.isOn () ? 1 : 0;
+
+			return -1;
+		}
+
+		// the gene draws from rand(), mRNA from its own engine
+		void reseed (uint64_t seed)
+		{
+			if (_type == MINGEN_MRNA)
+				m.reseed (seed);
+		}
+
 		// this is a public variable to tell if this particle needs to be removed 
 		// by a system after 1st order reaction (mRNA needs, Gene does not)
 		bool remove (void)
@@ -107,7 +147,7 @@ class MinGenParticle
 			PDL::MinGen::mRNA<Geometry>  m;
 			PDL::MinGen::Gene<Geometry>  g;
 		};
-		long int number;
+		int64_t number;
 
 };
 
@@ -151,40 +191,70 @@ class MinGenReaction
 
 		MinGenReaction (const MinGenFactory<Geometry> & F) : F(F) {};
 
-		bool apply (MinGenParticle<Geometry> * p, double dt, std::vector<MinGenParticle<Geometry>*> * l)
+		bool apply (MinGenParticle<Geometry> * p, double dt, std::vector<MinGenParticle<Geometry>*> * l);
+	private:
+		const MinGenFactory<Geometry> & F;
+};
+
+template<class Geometry>
+bool MinGenReaction<Geometry>::apply (MinGenParticle<Geometry> * p, double dt, std::vector<MinGenParticle<Geometry>*> * l)
+{
+	switch (p->type())
+	{
+		case MINGEN_MRNA:
 		{
-			switch (p->type())
+			PDL::MinGen::mRNA<Geometry> * m = p->getMRNA ();
+			if (m->degrade(dt))
 			{
-				case MINGEN_MRNA:
-				{
-					PDL::MinGen::mRNA<Geometry> * m = p->getMRNA ();
-					if (m->degrade(dt))
-					{
 //						std::cerr << "I am dying...." << std::endl;
-						return true;
-					}
-					break;
-				}
-				case MINGEN_GENE: 
-				{
-					PDL::MinGen::Gene<Geometry> * g = p->getGene ();
-
-					if (g->mRNA (dt))
-					{
-						MinGenParticle<Geometry> * mnew 
-							= F.createParticle (g->position(), MINGEN_MRNA);
-						l->push_back (mnew);
-						return true;
-					}
-					break;
-				}
+				return true;
+			}
+			break;
+		}
+		case MINGEN_GENE: 
+		{
+			PDL::MinGen::Gene<Geometry> * g = p->getGene ();
 
-				default:
-					throw "MinGenReaction: Unknown particle type ";
+			// mRNA is made in the present state, then the gene switches
+			bool made = g->mRNA (dt);
+			if (made)
+			{
+				MinGenParticle<Geometry> * mnew 
+					= F.createParticle (g->position(), MINGEN_MRNA);
+				l->push_back (mnew);
 			}
-			return false;
-		};
-	private:
-		const MinGenFactory<Geometry> & F;
-};
+			g->move (dt);
+			return made;
+		}
 
+		default:
+			throw "MinGenReaction: Unknown particle type ";
+	}
+	return false;
+}
+
+// The system of mingen/tests: MinGenParticle has no print () and
+// setPosition (), so only the members of System it uses are compiled into
+// libpdlib, not the whole class
+#define PDL_MINGEN_SYSTEM(ctype, dim) PDL::System<PDL::GeometryBox<ctype, dim>, \
+	MinGenFactory<PDL::GeometryBox<ctype, dim> >, MinGenReaction<PDL::GeometryBox<ctype, dim> >, \
+	PDL::Observables<PDL::GeometryBox<ctype, dim> > >
+#define PDL_MINGEN_MEMBERS(ext, ctype, dim) \
+	ext template PDL_MINGEN_SYSTEM(ctype, dim)::System (PDL::GeometryBox<ctype, dim> &, MinGenFactory<PDL::GeometryBox<ctype, dim> > &); \
+	ext template PDL_MINGEN_SYSTEM(ctype, dim)::~System (); \
+	ext template bool PDL_MINGEN_SYSTEM(ctype, dim)::evolve (const double); \
+	ext template void PDL_MINGEN_SYSTEM(ctype, dim)::insert (MinGenParticle<PDL::GeometryBox<ctype, dim> > *, bool); \
+	ext template void PDL_MINGEN_SYSTEM(ctype, dim)::delParticle (int);
+
+#ifdef PDL_EXTERN_TEMPLATES
+#define PDL_EXTERN(ctype, dim) \
+	extern template class MinGenParticle<PDL::GeometryBox<ctype, dim> >; \
+	extern template class MinGenFactory<PDL::GeometryBox<ctype, dim> >; \
+	extern template class MinGenReaction<PDL::GeometryBox<ctype, dim> >; \
+	extern template class PDL::CellList<PDL::GeometryBox<ctype, dim>, MinGenParticle<PDL::GeometryBox<ctype, dim> > >; \
+	PDL_MINGEN_MEMBERS (extern, ctype, dim)
+PDL_INSTANCES (PDL_EXTERN)
+#undef PDL_EXTERN
+#endif
+
+#endif
@@ -21,8 +21,10 @@
 
 #include <pdlib/system.hh>
 #include <pdlib/geom/box.hh>
+#include <pdlib/observables/observables.hh>
+#include <pdlib/observables/convergence.hh>
 
-#include "mingen.hh"
+#include <pdlib/mingen/mingen.hh>
 
 int main (int argc, char ** argv) 
 {
@@ -60,41 +62,58 @@ int main (int argc, char ** argv)
 	Factory F (kon, koff, kmbasal, km, D, dt, kdeg);
 	
 	typedef MinGenReaction<Box> Rxn;
-	PDL::System<Box, Factory, Rxn> system (b, F);
+	typedef PDL::Observables<Box> Obs;
+	typedef PDL::System<Box, Factory, Rxn, Obs> Sys;
+	Sys system (b, F);
 
 	Rxn rxn (F);
 	system.addReaction (rxn);
 
 	system.addParticle (x, MINGEN_GENE);
 
-	std::ofstream stream;
-//	stream.open("mRNA.dat", std::ios_base::app);
-	stream.open("mRNA.dat");
+	// mRNA copy number statistics, binned per minute, and the density
+	// sampled once a second
+	Obs obs (60., 1200, 1000, 600);
+	obs.addSpecies (MINGEN_MRNA);
+	obs.addDensity (b, 20, MINGEN_MRNA, rint (1./dt));
+	system.addObserver (&obs);
+
+	// run until the mean mRNA number is known to 5%, at least an hour
+	// and at most 20 hours
+	PDL::StopCriterion<Sys> stop (rint (60*60/dt));
+	stop.addTarget ([] (const Sys & s) {return s.getNParticles (MINGEN_MRNA);}, 0.05);
 
 	int tfinal = 20*60*60;
-	int N = rint (tfinal/dt);
 	int skip = 60;
 	int iskip = 1;
-	for (int i =0; i < N; i++)
+	auto progress = [&] (const Sys & s)
 	{
-		system.evolve (dt);
-
-		stream << system.time() << "     " << system.getNParticles() - 1 << std::endl;
-	
 		if ( !(iskip < skip) )
 		{
-			std::cerr << "*** t=" << system.time()/60 << " (" << system.getNParticles() - 1 
+			std::cerr << "*** t=" << s.time()/60 << " (" << s.getNParticles() - 1 
 				<< " mRNA) ***" << std::endl;
 			iskip = 0;
 		}
 		iskip++;
-	}
+		return stop (s);
+	};
+	if (system.evolveUntil (tfinal, dt, progress))
+		std::cerr << "converged at t=" << system.time()/60 << std::endl;
+	stop.statistics(0).print (&std::cerr);
 
 	// Check gene statistics
 	MinGenParticle<Box> * p = system.getParticle (0);
 	PDL::MinGen::Gene<Box> * g = p->getGene();
 	g->printStat (&std::cerr);
 
+	std::ofstream stream;
+	stream.open("mRNA.dat");
+	obs.print (&stream);
+	stream.close ();
+
+	stream.open("mRNA-density.dat");
+	obs.getDensity(0).print (&stream);
+
 	return 1;
 }
 
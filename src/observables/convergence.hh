@@ -0,0 +1,266 @@
+// convergence.hh
+// burn-in detection, confidence intervals and stop criteria for runs
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_OBSERVABLES_CONVERGENCE_HH
+# define PDLIB_OBSERVABLES_CONVERGENCE_HH
+
+#include <vector>
+#include <ostream>
+#include <functional>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+
+#include <pdlib/observables/stat.hh>
+
+namespace PDL
+{
+	// Student t quantile for nu degrees of freedom from the normal quantile z
+	// (Cornish-Fisher expansion, good to a few percent for nu >= 5)
+	inline double tQuantile (double z, double nu)
+	{
+		double z3 = z * z * z, z5 = z3 * z * z;
+		return z + (z3 + z) / (4. * nu) + (5. * z5 + 16. * z3 + 3. * z) / (96. * nu * nu);
+	}
+
+	// half width of the confidence interval of the mean of independent samples
+	// (e.g., replicas), z = 1.96 for 95%
+	inline double halfWidth (const RunningStat & s, double z = 1.96)
+	{
+		unsigned long int n = s.count ();
+		if (n < 2)
+			return std::numeric_limits<double>::max();
+		return tQuantile (z, n - 1) * sqrt (s.variance () / (n - 1));
+	}
+
+	// Batch means of a correlated time series with fixed memory: samples are
+	// averaged in nbatches batches; when all are full, neighbouring batches
+	// are merged and the batch size doubles. The initial transient is cut
+	// with MSER (the truncation minimising the standard error of the mean of
+	// the remaining batches), and the confidence interval of the stationary
+	// mean is computed from the batch means after the truncation.
+	class BatchMeans
+	{
+		public:
+			BatchMeans (int nbatches = 64)
+				: nbatches (nbatches + nbatches % 2), bsize (1), n (0),
+				sum (0.), wsum (0.) {};
+
+			void push (double x, double w = 1.)
+			{
+				sum += w * x;
+				wsum += w;
+				n++;
+				if (n % bsize)
+					return;
+
+				means.push_back (sum / wsum);
+				weights.push_back (wsum);
+				sum = wsum = 0.;
+
+				if (static_cast<int> (means.size()) == nbatches)
+				{
+					for (int i = 0; i < nbatches / 2; i++)
+					{
+						double w = weights[2*i] + weights[2*i + 1];
+						means[i] = (weights[2*i] * means[2*i] + weights[2*i + 1] * means[2*i + 1]) / w;
+						weights[i] = w;
+					}
+					means.resize (nbatches / 2);
+					weights.resize (nbatches / 2);
+					bsize *= 2;
+				}
+			}
+
+			unsigned long int count () const {return n;};
+			int batches () const {return means.size();};
+			unsigned long int batchSize () const {return bsize;};
+
+			// MSER truncation point in batches (at most half of them)
+			int burnIn () const
+			{
+				int k = batches ();
+				if (k < 2)
+					return 0;
+
+				// suffix sums of the batch means
+				double s = 0., s2 = 0.;
+				int best = k - 1;
+				double mser = std::numeric_limits<double>::max();
+				for (int d = k - 1; d >= 0; d--)
+				{
+					s += means[d];
+					s2 += means[d] * means[d];
+					int m = k - d;
+					if (d > k / 2 || m < 2)
+						continue;
+					double ss = s2 - s * s / m;
+					double e = ss / (static_cast<double> (m) * m);
+					if (e <= mser)
+					{
+						mser = e;
+						best = d;
+					}
+				}
+				return best;
+			}
+
+			// samples discarded as burn-in
+			unsigned long int burnInSamples () const {return burnIn () * bsize;};
+
+			// the truncation is well inside the series, so the rest of the
+			// run looks stationary
+			bool stationary () const
+			{
+				return batches () >= 10 && burnIn () < batches () / 2;
+			}
+
+			// stationary mean and its confidence interval
+			double mean () const
+			{
+				int d = burnIn ();
+				double m = 0., w = 0.;
+				for (int i = d; i < batches (); i++)
+				{
+					m += weights[i] * means[i];
+					w += weights[i];
+				}
+				return (w > 0.) ? m / w : 0.;
+			}
+
+			// lag 1 autocorrelation of the batch means after the burn-in; the
+			// interval is only trusted once batches are nearly independent
+			double correlation () const
+			{
+				int d = burnIn ();
+				int m = batches () - d;
+				if (m < 3)
+					return 1.;
+				double mu = mean (), c0 = 0., c1 = 0.;
+				for (int i = d; i < batches (); i++)
+				{
+					c0 += (means[i] - mu) * (means[i] - mu);
+					if (i > d)
+						c1 += (means[i] - mu) * (means[i-1] - mu);
+				}
+				return (c0 > 0.) ? c1 / c0 : 0.;
+			}
+
+			double halfWidth (double z = 1.96) const
+			{
+				int d = burnIn ();
+				int m = batches () - d;
+				if (m < 2)
+					return std::numeric_limits<double>::max();
+				double mu = mean (), s2 = 0.;
+				for (int i = d; i < batches (); i++)
+					s2 += (means[i] - mu) * (means[i] - mu);
+				s2 /= m - 1;
+				return tQuantile (z, m - 1) * sqrt (s2 / m);
+			}
+
+			void print (std::ostream * stream) const
+			{
+				*stream << "mean: " << mean () << " +- " << halfWidth ()
+					<< " (burn-in " << burnInSamples () << " of " << n << " samples, "
+					<< batches () << " batches of " << bsize << ")" << std::endl;
+			}
+
+		private:
+			const int nbatches;
+			unsigned long int bsize; // samples per batch
+			unsigned long int n;
+			double sum, wsum; // the batch being filled
+			std::vector<double> means;
+			std::vector<double> weights;
+	};
+
+	// Stop criterion for System::evolveUntil: observables of the system are
+	// sampled every step, and the run may stop once each of them is past its
+	// burn-in, its batch means are nearly uncorrelated and its mean is known
+	// to the requested precision, halfWidth <= max (relTol * |mean|, absTol).
+	// Runs shorter than minSamples steps are never stopped (a series which
+	// has not moved yet, e.g., no molecule made so far, looks converged)
+	template<class S>
+		class StopCriterion
+		{
+			public:
+				typedef std::function<double (const S &)> Observable;
+
+				StopCriterion (unsigned long int minSamples = 1000, double z = 1.96, int nbatches = 64)
+					: minSamples (minSamples), z (z), nbatches (nbatches) {};
+
+				int addTarget (Observable f, double relTol, double absTol = 0.)
+				{
+					Target t = {f, relTol, absTol, BatchMeans (nbatches)};
+					targets.push_back (t);
+					return targets.size() - 1;
+				}
+
+				void sample (const S & s)
+				{
+					for (unsigned int i = 0; i < targets.size(); i++)
+						targets[i].stat.push (targets[i].f (s));
+				}
+
+				bool converged () const
+				{
+					for (unsigned int i = 0; i < targets.size(); i++)
+					{
+						const BatchMeans & b = targets[i].stat;
+						if (b.count () < minSamples || !b.stationary () || b.correlation () > 0.3)
+							return false;
+						double tol = std::max (targets[i].relTol * fabs (b.mean ()), targets[i].absTol);
+						if (b.halfWidth (z) > tol)
+							return false;
+					}
+					return !targets.empty();
+				}
+
+				// sample and check
+				bool operator() (const S & s)
+				{
+					sample (s);
+					return converged ();
+				}
+
+				const BatchMeans & statistics (int i) const {return targets.at(i).stat;};
+
+			private:
+				struct Target
+				{
+					Observable f;
+					double relTol;
+					double absTol;
+					BatchMeans stat;
+				};
+
+				const unsigned long int minSamples;
+				const double z;
+				const int nbatches;
+				std::vector<Target> targets;
+		};
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,248 @@
+// observables.hh
+// observers for PDL::System: copy-number statistics and density grids
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_OBSERVABLES_HH
+# define PDLIB_OBSERVABLES_HH
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <ostream>
+
+#include <dune/common/fvector.hh>
+
+#include <pdlib/observables/stat.hh>
+
+namespace PDL
+{
+	// Copy number statistics of one particle type: time-weighted mean and
+	// variance, histogram, autocorrelation and a time-binned trajectory.
+	// Each sample costs O(1) (O(maxlag) for the autocorrelation) since the
+	// System keeps the number of particles of each type. A sample is
+	// weighted by the time since the previous one, so the first sample
+	// after attaching has no weight and only enters the autocorrelation
+	class CopyNumber
+	{
+		public:
+			CopyNumber (int type, int nmax, double tbin, int nbins, int maxlag)
+				: type (type), hist (-0.5, nmax + 0.5, nmax + 1),
+				acf (maxlag), traj (tbin, nbins),
+				tlast (std::numeric_limits<double>::quiet_NaN ()) {};
+
+			template<class S>
+				void sample (const S & s)
+				{
+					double t = s.time ();
+					double n = s.getNParticles (type);
+
+					if (!std::isnan (tlast))
+					{
+						double dt = t - tlast;
+						stat.push (n, dt);
+						hist.push (n, dt);
+						traj.push (t, n, dt);
+					}
+					acf.push (n);
+
+					tlast = t;
+				}
+
+			int getType () const {return type;};
+			const RunningStat & statistics () const {return stat;};
+			const Histogram & histogram () const {return hist;};
+			const Autocorrelation & autocorrelation () const {return acf;};
+			const TimeBinnedAverage & trajectory () const {return traj;};
+
+			void print (std::ostream * stream) const
+			{
+				*stream << "# type " << type << ": ";
+				stat.print (stream);
+				*stream << "# integrated autocorrelation time (samples): " << acf.tau () << std::endl;
+				*stream << "# histogram" << std::endl;
+				hist.print (stream);
+				*stream << std::endl << std::endl << "# time-binned average" << std::endl;
+				traj.print (stream);
+				*stream << std::endl << std::endl;
+			}
+
+		private:
+			const int type;
+			RunningStat stat;
+			Histogram hist;
+			Autocorrelation acf;
+			TimeBinnedAverage traj;
+			double tlast;
+	};
+
+	// Time-averaged number density of particles of a type (all types if
+	// type < 0) on a regular grid covering the geometry. A sample scans all
+	// particles, O(N), so only every k-th call of sample () is taken: the
+	// density changes little over k steps when k dt is small compared to
+	// the time to diffuse across a cell
+	template<class Geometry>
+		class DensityGrid
+		{
+			public:
+				typedef typename Geometry::Space Space;
+
+				DensityGrid (const Geometry & g, int cells, int type = -1, int every = 1)
+					: type (type), every ((every > 0) ? every : 1), calls (0), xl (g.lower()), n (0), nsamples (0)
+				{
+					Space H = g.upper();
+					H -= xl;
+					int total = 1;
+					for (int i = 0; i < Geometry::dimension; i++)
+					{
+						h[i] = H[i] / cells;
+						n[i] = cells;
+						total *= cells;
+					}
+					grid.assign (total, 0.);
+				};
+
+				template<class S>
+					void sample (const S & s)
+					{
+						if (calls++ % every != 0)
+							return;
+						for (int i = 0; i < s.getNParticles(); i++)
+						{
+							const typename S::Particle * p = s.getParticle (i);
+							if (type >= 0 && p->type() != type)
+								continue;
+							int c = cell (p->position());
+							if (c >= 0)
+								grid[c] += 1.;
+						}
+						nsamples++;
+					}
+
+				int cell (const Space & x) const
+				{
+					int c = 0;
+					for (int i = Geometry::dimension - 1; i >= 0; i--)
+					{
+						int k = static_cast<int> ((x[i] - xl[i]) / h[i]);
+						if (k == n[i]) k--; // right boundary belongs to the last cell
+						if (k < 0 || k >= n[i])
+							return -1;
+						c = c * n[i] + k;
+					}
+					return c;
+				}
+
+				double volume () const
+				{
+					double v = 1.;
+					for (int i = 0; i < Geometry::dimension; i++)
+						v *= h[i];
+					return v;
+				}
+
+				double density (int c) const
+				{
+					return (nsamples > 0) ? grid.at(c) / (nsamples * volume ()) : 0.;
+				}
+
+				int size () const {return grid.size();};
+
+				void print (std::ostream * stream) const
+				{
+					for (int c = 0; c < size(); c++)
+					{
+						int r = c;
+						for (int i = 0; i < Geometry::dimension; i++)
+						{
+							*stream << xl[i] + (r % n[i] + 0.5) * h[i] << " ";
+							r /= n[i];
+						}
+						*stream << "    " << density (c) << std::endl;
+					}
+				}
+
+			private:
+				const int type;
+				const int every;
+				unsigned long int calls;
+				Space xl;
+				Space h;
+				Dune::FieldVector<int, Geometry::dimension> n;
+				std::vector<double> grid;
+				unsigned long int nsamples;
+		};
+
+	// A collection of observers which can be attached to a System
+	template<class Geometry>
+		class Observables
+		{
+			public:
+				Observables (double tbin = 60., int nbins = 1024, int nmax = 1000, int maxlag = 100)
+					: tbin (tbin), nbins (nbins), nmax (nmax), maxlag (maxlag) {};
+
+				~Observables ()
+				{
+					for (unsigned int i = 0; i < densities.size(); i++)
+						delete densities[i];
+				}
+
+				void addSpecies (int type)
+				{
+					species.push_back (CopyNumber (type, nmax, tbin, nbins, maxlag));
+				}
+
+				// sampled every k-th step, see DensityGrid
+				void addDensity (const Geometry & g, int cells, int type = -1, int every = 1)
+				{
+					densities.push_back (new DensityGrid<Geometry> (g, cells, type, every));
+				}
+
+				template<class S>
+					void sample (const S & s)
+					{
+						for (unsigned int i = 0; i < species.size(); i++)
+							species[i].sample (s);
+						for (unsigned int i = 0; i < densities.size(); i++)
+							densities[i]->sample (s);
+					}
+
+				const CopyNumber & getSpecies (int i) const {return species.at (i);};
+				const DensityGrid<Geometry> & getDensity (int i) const {return *densities.at (i);};
+
+				void print (std::ostream * stream) const
+				{
+					for (unsigned int i = 0; i < species.size(); i++)
+						species[i].print (stream);
+				}
+
+			private:
+				const double tbin;
+				const int nbins, nmax, maxlag;
+				std::vector<CopyNumber> species;
+				std::vector<DensityGrid<Geometry>*> densities;
+
+				Observables (const Observables &);
+		};
+
+}; // namespace PDL
+
+#endif
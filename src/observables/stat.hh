@@ -0,0 +1,269 @@
+// stat.hh
+// online (streaming) statistics: running moments, histograms,
+// autocorrelation and time-binned averages
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_OBSERVABLES_STAT_HH
+# define PDLIB_OBSERVABLES_STAT_HH
+
+#include <vector>
+#include <ostream>
+#include <cmath>
+#include <limits>
+
+namespace PDL
+{
+	// Weighted running mean and variance (West's update of Welford's algorithm).
+	// Weights are typically time intervals, so that time averages come for free
+	class RunningStat
+	{
+		public:
+			RunningStat () : n (0), W (0), M (0), S (0),
+				xmin (std::numeric_limits<double>::max()),
+				xmax (-std::numeric_limits<double>::max()) {};
+
+			void push (double x, double w = 1.)
+			{
+				if (w <= 0.)
+					return;
+				n++;
+				W += w;
+				double delta = x - M;
+				M += delta * w / W;
+				S += w * delta * (x - M);
+				if (x < xmin) xmin = x;
+				if (x > xmax) xmax = x;
+			}
+
+			void reset () {*this = RunningStat ();};
+
+			unsigned long int count () const {return n;};
+			double weight () const {return W;};
+			double mean () const {return M;};
+			double variance () const {return (W > 0.) ? S / W : 0.;};
+			double stddev () const {return sqrt (variance ());};
+			double min () const {return xmin;};
+			double max () const {return xmax;};
+
+			void print (std::ostream * stream) const
+			{
+				*stream << "mean: " << mean() << " variance: " << variance()
+					<< " min: " << xmin << " max: " << xmax
+					<< " (" << n << " samples)" << std::endl;
+			}
+
+		private:
+			unsigned long int n; // number of samples
+			double W; // total weight
+			double M; // mean
+			double S; // sum of weighted squared deviations
+			double xmin, xmax;
+	};
+
+	// Fixed-bin histogram on [xmin, xmax) with under- and overflow counters
+	class Histogram
+	{
+		public:
+			Histogram (double xmin, double xmax, int nbins)
+				: xmin (xmin), xmax (xmax), h ((xmax - xmin) / nbins),
+				bins (nbins, 0.), under (0), over (0), total (0) {};
+
+			void push (double x, double w = 1.)
+			{
+				total += w;
+				if (x < xmin)
+					under += w;
+				else if (!(x < xmax))
+					over += w;
+				else
+					bins[static_cast<int> ((x - xmin) / h)] += w;
+			}
+
+			int size () const {return bins.size();};
+			double binWidth () const {return h;};
+			double binCenter (int i) const {return xmin + (i + 0.5) * h;};
+			double bin (int i) const {return bins.at (i);};
+			double underflow () const {return under;};
+			double overflow () const {return over;};
+
+			// normalised probability density in bin i
+			double density (int i) const
+			{
+				return (total > 0.) ? bins.at(i) / (total * h) : 0.;
+			}
+
+			void print (std::ostream * stream) const
+			{
+				for (int i = 0; i < size(); i++)
+					*stream << binCenter(i) << "     " << density(i) << std::endl;
+			}
+
+		private:
+			const double xmin, xmax, h;
+			std::vector<double> bins;
+			double under, over, total;
+	};
+
+	// Autocorrelation function up to lag maxlag for an equally spaced series.
+	// The last maxlag samples are kept in a ring buffer, so memory is fixed
+	// and a push costs O(maxlag), independent of the length of the run
+	class Autocorrelation
+	{
+		public:
+			Autocorrelation (int maxlag)
+				: maxlag (maxlag), ring (maxlag + 1, 0.), head (0), n (0),
+				sum (0), C (maxlag + 1, 0.), N (maxlag + 1, 0) {};
+
+			void push (double x)
+			{
+				head = (head + 1) % (maxlag + 1);
+				ring[head] = x;
+				n++;
+				sum += x;
+
+				int lags = (n <= static_cast<unsigned long int> (maxlag)) ? n - 1 : maxlag;
+				for (int k = 0; k <= lags; k++)
+				{
+					C[k] += x * ring[(head + maxlag + 1 - k) % (maxlag + 1)];
+					N[k]++;
+				}
+			}
+
+			int maxLag () const {return maxlag;};
+			double mean () const {return (n > 0) ? sum / n : 0.;};
+
+			// autocovariance at lag k
+			double covariance (int k) const
+			{
+				if (k > maxlag || N[k] == 0)
+					return 0.;
+				double m = mean ();
+				return C[k] / N[k] - m * m;
+			}
+
+			// normalised autocorrelation at lag k
+			double operator() (int k) const
+			{
+				double c0 = covariance (0);
+				return (c0 > 0.) ? covariance (k) / c0 : 0.;
+			}
+
+			// integrated autocorrelation time in units of the sampling interval
+			double tau () const
+			{
+				double t = 0.5;
+				for (int k = 1; k <= maxlag; k++)
+				{
+					double r = (*this)(k);
+					if (r <= 0.)
+						break;
+					t += r;
+				}
+				return t;
+			}
+
+			void print (std::ostream * stream, double dt = 1.) const
+			{
+				for (int k = 0; k <= maxlag; k++)
+					*stream << k * dt << "     " << (*this)(k) << std::endl;
+			}
+
+		private:
+			const int maxlag;
+			std::vector<double> ring; // last maxlag + 1 samples
+			int head;
+			unsigned long int n;
+			double sum;
+			std::vector<double> C; // sum of x_t x_{t-k}
+			std::vector<unsigned long int> N;
+	};
+
+	// Time averages of a quantity in consecutive time bins. When the run
+	// outgrows the bins, neighbouring bins are merged and the bin width
+	// doubles, so memory stays fixed however long the run is
+	class TimeBinnedAverage
+	{
+		public:
+			TimeBinnedAverage (double tbin, int nbins)
+				: tbin (tbin), value (nbins, 0.), weight (nbins, 0.) {};
+
+			// value x held during [t - dt, t); an interval longer than a
+			// bin is split across the bins it covers
+			void push (double t, double x, double dt)
+			{
+				double t0 = (t - dt > 0.) ? t - dt : 0.;
+				if (!(t > t0))
+					return;
+				while (t > size() * tbin)
+					coarsen ();
+				for (int i = static_cast<int> (t0 / tbin); i < size() && i * tbin < t; i++)
+				{
+					double a = (t0 > i * tbin) ? t0 : i * tbin;
+					double b = (t < (i + 1) * tbin) ? t : (i + 1) * tbin;
+					if (b > a)
+					{
+						value[i] += x * (b - a);
+						weight[i] += b - a;
+					}
+				}
+			}
+
+			int size () const {return value.size();};
+			double binWidth () const {return tbin;};
+			double time (int i) const {return (i + 0.5) * tbin;};
+			double operator[] (int i) const
+			{
+				return (weight.at(i) > 0.) ? value[i] / weight[i] : 0.;
+			}
+
+			void print (std::ostream * stream) const
+			{
+				for (int i = 0; i < size(); i++)
+					if (weight[i] > 0.)
+						*stream << time(i) << "     " << (*this)[i] << std::endl;
+			}
+
+		private:
+			double tbin;
+			std::vector<double> value; // integral of x over the bin
+			std::vector<double> weight; // time covered in the bin
+
+			void coarsen ()
+			{
+				int n = size();
+				for (int i = 0; i < n / 2; i++)
+				{
+					value[i] = value[2*i] + value[2*i + 1];
+					weight[i] = weight[2*i] + weight[2*i + 1];
+				}
+				for (int i = n / 2; i < n; i++)
+				{
+					value[i] = (2*i < n) ? value[2*i] : 0.;
+					weight[i] = (2*i < n) ? weight[2*i] : 0.;
+				}
+				tbin *= 2.;
+			}
+	};
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,85 @@
+/* testConvergence.cc  2015-07-01 test burn-in detection and stop criteria
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <random>
+
+#include <pdlib/observables/convergence.hh>
+
+// AR(1) process x_t = m + a (x_{t-1} - m) + noise started far from m
+struct AR
+{
+	AR (double x0) : x (x0), engine (1), noise (0., 1.) {};
+	void step () {x = 5. + 0.9 * (x - 5.) + noise (engine);};
+
+	double x;
+	std::mt19937 engine;
+	std::normal_distribution<double> noise;
+};
+
+int main (int argc, char ** argv) 
+{
+	// stationary mean 5, variance 1/(1-a^2) ~ 5.3, tau ~ 10;
+	// the transient from x = 100 decays within ~50 steps
+	AR ar (100.);
+	PDL::StopCriterion<AR> stop;
+	stop.addTarget ([] (const AR & p) {return p.x;}, 0.01);
+
+	int n = 0;
+	while (n < 10000000)
+	{
+		ar.step ();
+		n++;
+		if (stop (ar))
+			break;
+	}
+
+	const PDL::BatchMeans & b = stop.statistics (0);
+	std::cerr << "stopped after " << n << " steps" << std::endl;
+	b.print (&std::cerr);
+	std::cerr << "mean: " << b.mean () << " (5), expected half width ~ " 
+		<< 1.96 * sqrt (2. * 9.5 * 5.26 / (n - b.burnInSamples ())) << std::endl;
+
+	// the interval covers the true mean in about 95% of independent runs
+	int covered = 0;
+	for (int r = 0; r < 200; r++)
+	{
+		AR p (100.);
+		p.engine.seed (r + 2);
+		PDL::BatchMeans m;
+		for (int i = 0; i < 100000; i++)
+		{
+			p.step ();
+			m.push (p.x);
+		}
+		if (fabs (m.mean () - 5.) <= m.halfWidth ())
+			covered++;
+	}
+	std::cerr << "coverage: " << covered / 200. << " (0.95)" << std::endl;
+
+	// independent replicas
+	PDL::RunningStat s;
+	std::mt19937 engine (1);
+	std::normal_distribution<double> noise (5., 1.);
+	for (int i = 0; i < 100; i++)
+		s.push (noise (engine));
+	std::cerr << "replicas: " << s.mean () << " +- " << PDL::halfWidth (s) << " (5 +- 0.2)" << std::endl;
+
+	return 1;
+}
@@ -0,0 +1,84 @@
+/* testStat.cc  2015-07-01 test online statistics
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <random>
+
+#include <pdlib/observables/stat.hh>
+#include <pdlib/observables/observables.hh>
+
+// just enough of a System for CopyNumber
+struct Counter
+{
+	double t;
+	int n;
+	double time () const {return t;};
+	int getNParticles (int type) const {return n;};
+};
+
+int main (int argc, char ** argv) 
+{
+	std::mt19937 engine (1);
+	std::normal_distribution<double> noise (0., 1.);
+
+	// AR(1) process x_t = a x_{t-1} + noise: 
+	// variance 1/(1-a^2), autocorrelation a^k
+	double a = 0.9;
+	double x = 0.;
+
+	PDL::RunningStat stat;
+	PDL::Histogram hist (-10., 10., 40);
+	PDL::Autocorrelation acf (20);
+	PDL::TimeBinnedAverage traj (1., 16);
+
+	for (int i = 0; i < 1000000; i++)
+	{
+		x = a * x + noise (engine);
+		stat.push (x);
+		hist.push (x);
+		acf.push (x);
+		traj.push (i + 1, x, 1.);
+	}
+
+	std::cerr << "mean: " << stat.mean () << " (0)" << std::endl;
+	std::cerr << "variance: " << stat.variance () << " (" << 1. / (1. - a*a) << ")" << std::endl;
+	std::cerr << "acf(5): " << acf(5) << " (" << pow (a, 5) << ")" << std::endl;
+	std::cerr << "tau: " << acf.tau () << " (" << 0.5 * (1. + a) / (1. - a) << ")" << std::endl;
+	std::cerr << "time bins: " << traj.size () << " of width " << traj.binWidth () << std::endl;
+
+	// a value held for half a bin, then another for three bins
+	PDL::TimeBinnedAverage span (1., 16);
+	span.push (0.5, 1., 0.5);
+	span.push (3.5, 3., 3.);
+	std::cerr << "long interval: " << span[0] << " " << span[1] << " " << span[2] << " " << span[3]
+		<< " (2 3 3 3)" << std::endl;
+
+	// an observer attached at t = 100 must not weight its first sample
+	// with the time elapsed before it was attached
+	PDL::CopyNumber late (0, 10, 1., 16, 5);
+	Counter c = {100., 5};
+	late.sample (c);
+	c.t = 101.; c.n = 7;
+	late.sample (c);
+	std::cerr << "late observer mean: " << late.statistics ().mean () << " (7)" << std::endl;
+
+	hist.print (&std::cout);
+
+	return 1;
+}
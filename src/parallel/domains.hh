@@ -0,0 +1,580 @@
+// domains.hh
+// domain decomposition of a system across local processes
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_PARALLEL_DOMAINS_HH
+# define PDLIB_PARALLEL_DOMAINS_HH
+
+#include <vector>
+#include <iostream>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <stdint.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include <pdlib/random.hh>
+#include <pdlib/parallel/shm.hh>
+
+namespace PDL
+{
+	typedef enum {
+		PDL_DOMAIN_MIGRANT, // a particle moving to the neighbour
+		PDL_DOMAIN_GHOST,   // a copy of a particle within the halo
+		PDL_DOMAIN_END      // no more records this step
+	} DomainRecordKind;
+
+	// Slab decomposition of a system along one axis of its bounding box,
+	// every slab run by a forked process with its own System. Each process
+	// holds the whole geometry (so boundaries act as before) but only the
+	// particles in its slab.
+	//
+	// After every step particles which left the slab are sent to the
+	// neighbour through single producer, single consumer rings in POSIX
+	// shared memory. A migrant carries its type, position, number and a
+	// new seed for its random engine; the factory makes it anew on the
+	// other side, so any other state of the particle (e.g., of a MinGen
+	// gene) is lost. The number k a particle got from make (r) becomes
+	// k n + r, and new particles are numbered so that numbers stay unique
+	// across slabs. Then copies of the particles within the halo width of
+	// the slab faces are sent (ghosts, see ghosts ()). Exchanges only wait
+	// for the neighbours.
+	//
+	// With balancing, every few steps the slabs exchange histograms of their
+	// particles along the axis and move the faces towards equal numbers of
+	// particles per slab (by at most half a slab, so particles still go to
+	// a neighbour only), e.g., when mRNA clusters around genes. Balancing
+	// synchronises all slabs (two barriers), so it should not be done
+	// every step.
+	//
+	// Processes may be pinned to CPUs; the System of a process and its
+	// incoming rings are first touched by the process itself, so on a NUMA
+	// node they are allocated on its socket.
+	//
+	// S is a System, Type the particle type argument of its factory.
+	template<class S, typename Type = int>
+		class DomainDecomposition
+		{
+			public:
+				typedef typename S::Particle Particle;
+				typedef typename Particle::Space Space;
+				typedef typename Space::field_type ctype;
+				enum {dimension = Space::dimension};
+
+				// observables of a slab, written as m values to row
+				typedef std::function<void (const S &, double * row)> Observable;
+
+				DomainDecomposition (int n, const Space & lower, const Space & upper, int axis = 0,
+					size_t ringSize = 1 << 14)
+					: n (n), axis (axis), L (lower[axis]), U (upper[axis]), ringSize (ringSize),
+					halo (0.), balanceEvery (0), binsPerSlab (64), pin (false),
+					nobs (0), sampleEvery (0), nsamples (0), rank (-1), sys (nullptr), ghostsys (nullptr)
+				{
+					for (int k = 0; k <= n; k++)
+						faces.push_back (L + (U - L) * k / n);
+				};
+
+				// width of the layer copied to the neighbours as ghosts
+				void setHalo (double w) {halo = w;};
+
+				// rebalance every so many steps (0: fixed slabs)
+				void setBalancing (int every, int bins = 64)
+				{
+					balanceEvery = every;
+					binsPerSlab = bins;
+				}
+
+				// pin process k to CPU k (modulo the number of CPUs)
+				void setPinning (bool p) {pin = p;};
+
+				// sample m observables every so many steps, summed over slabs
+				void setObservable (int m, Observable f, int every)
+				{
+					nobs = m;
+					obs = f;
+					sampleEvery = every;
+				}
+
+				// Run nsteps steps of dt in n processes; make (rank) returns
+				// the System of a slab (particles it does not own are dropped,
+				// so make may use owns () to create only its own). Returns
+				// false if a process failed (evolve returned false, or it died).
+				template<class Make>
+				bool run (Make make, int nsteps, double dt)
+				{
+					nsamples = (sampleEvery > 0) ? nsteps / sampleEvery + 1 : 0;
+					SharedMemory shm (layout ());
+					char * base = static_cast<char*> (shm.data());
+					attach (base);
+
+					uint64_t seed0 = Random::next ();
+					std::cout.flush ();
+					std::cerr.flush ();
+
+					std::vector<pid_t> pids (n, -1);
+					for (int r = 0; r < n; r++)
+					{
+						pids[r] = fork ();
+						if (pids[r] < 0)
+						{
+							std::cerr << "DomainDecomposition: cannot fork" << std::endl;
+							cancel->store (1);
+							break;
+						}
+						if (pids[r] == 0)
+						{
+							int status = 1;
+							try
+							{
+								status = worker (r, make, nsteps, dt, Random::mix (seed0 + r)) ? 0 : 1;
+							}
+							catch (const std::exception & e)
+							{
+								std::cerr << "DomainDecomposition: slab " << r << ": " << e.what() << std::endl;
+								cancel->store (1);
+							}
+							std::cout.flush ();
+							std::cerr.flush ();
+							_exit (status);
+						}
+					}
+
+					// reap our own processes in any order, so that a process
+					// which died is noticed while the others wait for it
+					bool ok = true;
+					int alive = std::count_if (pids.begin(), pids.end(), [] (pid_t p) {return p > 0;});
+					while (alive > 0)
+					{
+						bool reaped = false;
+						for (int r = 0; r < n; r++)
+						{
+							int status = 0;
+							if (pids[r] <= 0)
+								continue;
+							pid_t w = waitpid (pids[r], &status, WNOHANG);
+							if (w == 0 || (w < 0 && errno == EINTR))
+								continue;
+							pids[r] = -1;
+							alive--;
+							reaped = true;
+							if (w > 0 && WIFEXITED (status) && WEXITSTATUS (status) == 0)
+								continue;
+							if (w > 0 && WIFSIGNALED (status))
+								std::cerr << "DomainDecomposition: slab " << r
+									<< " killed by signal " << WTERMSIG (status) << std::endl;
+							ok = false;
+							cancel->store (1); // release the others from their waits
+						}
+						if (!reaped)
+							usleep (1000);
+					}
+					ok = ok && !cancel->load ();
+
+					// copy the results out of the shared memory
+					faces.assign (sharedFaces, sharedFaces + n + 1);
+					counts.assign (sharedCounts, sharedCounts + n);
+					moved.assign (sharedMigrants, sharedMigrants + n);
+					table.assign (samples, samples + static_cast<size_t> (nsamples) * n * nobs);
+					times.assign (sampleTimes, sampleTimes + nsamples);
+					return ok;
+				}
+
+				// in a process: its slab, and the ghosts received in the last step
+				int getRank () const {return rank;};
+				bool owns (const Space & x) const
+				{
+					return (x[axis] >= lo || rank == 0) && (x[axis] < hi || rank == n - 1);
+				}
+				double slabLower () const {return lo;};
+				double slabUpper () const {return hi;};
+
+				// The ghosts received in the last exchange, as a System (with
+				// the numbers of the particles in their own slabs) which is
+				// not evolved, so that its queries see them
+				S & ghosts () const {return *ghostsys;};
+
+				// queries over the particles of the slab and the ghosts
+				int countInBox (const Space & lo, const Space & hi, int type = -1) const
+				{
+					return sys->countInBox (lo, hi, type) + ghostsys->countInBox (lo, hi, type);
+				}
+				int countInSphere (const Space & x, double r, int type = -1) const
+				{
+					return sys->countInSphere (x, r, type) + ghostsys->countInSphere (x, r, type);
+				}
+
+				// after run: samples summed over slabs, final slabs and particles
+				int nSamples () const {return nsamples;};
+				double sampleTime (int k) const {return times.at (k);};
+				std::vector<double> sample (int k) const
+				{
+					std::vector<double> s (nobs, 0.);
+					for (int r = 0; r < n; r++)
+						for (int j = 0; j < nobs; j++)
+							s[j] += table.at ((static_cast<size_t> (k) * n + r) * nobs + j);
+					return s;
+				}
+				double sample (int k, int rank, int j) const
+				{
+					return table.at ((static_cast<size_t> (k) * n + rank) * nobs + j);
+				}
+				int nDomains () const {return n;};
+				double face (int k) const {return faces.at (k);};
+				long int particles (int rank) const {return counts.at (rank);};
+				unsigned long int migrants () const
+				{
+					unsigned long int m = 0;
+					for (unsigned int r = 0; r < moved.size(); r++)
+						m += moved[r];
+					return m;
+				}
+
+			private:
+				struct Record
+				{
+					uint64_t seed; // of a migrant's random engine
+					int64_t number;
+					int32_t type;
+					int32_t kind;
+					ctype x[dimension];
+				};
+				typedef ShmRing<Record> Ring;
+
+				const int n;
+				const int axis;
+				const double L, U;
+				const size_t ringSize;
+				double halo;
+				int balanceEvery, binsPerSlab;
+				bool pin;
+				int nobs;
+				Observable obs;
+				int sampleEvery, nsamples;
+
+				// results, copied from the shared memory
+				std::vector<double> faces;
+				std::vector<long int> counts;
+				std::vector<unsigned long int> moved;
+				std::vector<double> table, times;
+
+				// shared memory
+				std::atomic<int> * cancel;
+				ShmBarrier barrier;
+				std::vector<Ring> rings; // 2 r: from r to the left, 2 r + 1: to the right
+				double * sharedFaces;
+				long int * sharedCounts;
+				unsigned long int * sharedMigrants;
+				double * histograms;
+				double * samples;
+				double * sampleTimes;
+				int64_t * sharedNumbers;
+				size_t offsets[10];
+
+				// the slab of this process
+				int rank;
+				double lo, hi;
+				S * sys;
+				S * ghostsys;
+				std::vector<Record> out[2];
+
+				static size_t align (size_t b) {return (b + 63) / 64 * 64;};
+
+				size_t layout ()
+				{
+					size_t b = 0;
+					offsets[0] = b; b += align (sizeof (std::atomic<int>));
+					offsets[1] = b; b += align (ShmBarrier::bytes ());
+					offsets[2] = b; b += 2 * n * align (Ring::bytes (ringSize));
+					offsets[3] = b; b += align ((n + 1) * sizeof (double));
+					offsets[4] = b; b += align (n * sizeof (long int));
+					offsets[5] = b; b += align (n * sizeof (unsigned long int));
+					offsets[6] = b; b += align (static_cast<size_t> (n) * n * binsPerSlab * sizeof (double));
+					offsets[7] = b; b += align (static_cast<size_t> (nsamples) * n * nobs * sizeof (double));
+					offsets[8] = b; b += align (nsamples * sizeof (double));
+					offsets[9] = b; b += align (n * sizeof (int64_t));
+					return b;
+				}
+
+				void attach (char * base)
+				{
+					cancel = new (base + offsets[0]) std::atomic<int>;
+					cancel->store (0);
+					barrier = ShmBarrier::create (base + offsets[1], n);
+					rings.clear ();
+					for (int i = 0; i < 2 * n; i++)
+						rings.push_back (Ring::create (base + offsets[2] + i * align (Ring::bytes (ringSize)), ringSize));
+					sharedFaces = reinterpret_cast<double*> (base + offsets[3]);
+					sharedCounts = reinterpret_cast<long int*> (base + offsets[4]);
+					sharedMigrants = reinterpret_cast<unsigned long int*> (base + offsets[5]);
+					histograms = reinterpret_cast<double*> (base + offsets[6]);
+					samples = reinterpret_cast<double*> (base + offsets[7]);
+					sampleTimes = reinterpret_cast<double*> (base + offsets[8]);
+					sharedNumbers = reinterpret_cast<int64_t*> (base + offsets[9]);
+					std::copy (faces.begin(), faces.end(), sharedFaces);
+				}
+
+				template<class Make>
+				bool worker (int r, Make & make, int nsteps, double dt, uint64_t seed)
+				{
+#ifdef __linux__
+					if (pin)
+					{
+						cpu_set_t set;
+						CPU_ZERO (&set);
+						CPU_SET (r % sysconf (_SC_NPROCESSORS_ONLN), &set);
+						sched_setaffinity (0, sizeof (set), &set);
+					}
+#endif
+					rank = r;
+					lo = faces[r];
+					hi = faces[r + 1];
+					Random::seed (seed);
+
+					// first touch of the incoming rings
+					if (r > 0)
+						rings[2 * (r - 1) + 1].touch ();
+					if (r < n - 1)
+						rings[2 * (r + 1)].touch ();
+					if (!barrier.wait (cancel))
+						return false;
+
+					sys = make (r);
+					sys->removeParticles ([this] (const Particle * p) {return !owns (p->position());});
+					ghostsys = new S (sys->geometry (), sys->factory ());
+					sharedMigrants[r] = 0;
+
+					// numbers unique across slabs: k becomes k n + r, and new
+					// particles are numbered M n + r, (M + 1) n + r, ... with M
+					// above the numbers made by any slab
+					sharedNumbers[r] = sys->nextNumber ();
+					if (!barrier.wait (cancel))
+						return false;
+					int64_t M = *std::max_element (sharedNumbers, sharedNumbers + n);
+					for (int i = 0; i < sys->getNParticles (); i++)
+						sys->getParticle (i)->setNumber (sys->getParticle (i)->getNumber () * n + r);
+					sys->setNumbering (M * n + r, n);
+
+					bool ok = exchange ();
+					if (ok && sampleEvery > 0)
+						store (0);
+					for (int step = 1; ok && step <= nsteps; step++)
+					{
+						if (!sys->evolve (dt))
+						{
+							std::cerr << "DomainDecomposition: slab " << r << " failed at step " << step << std::endl;
+							cancel->store (1);
+							return false;
+						}
+						if (balanceEvery > 0 && step % balanceEvery == 0)
+							ok = balance ();
+						ok = ok && exchange ();
+						if (ok && sampleEvery > 0 && step % sampleEvery == 0)
+							store (step / sampleEvery);
+					}
+					sharedCounts[r] = sys->getNParticles ();
+					return ok && !cancel->load ();
+				}
+
+				void store (int k)
+				{
+					obs (*sys, samples + (static_cast<size_t> (k) * n + rank) * nobs);
+					if (rank == 0)
+						sampleTimes[k] = sys->time ();
+				}
+
+				Record record (const Particle * p, int kind) const
+				{
+					Record q;
+					q.seed = (kind == PDL_DOMAIN_MIGRANT) ? Random::next () : 0;
+					q.type = p->type ();
+					q.kind = kind;
+					q.number = p->getNumber ();
+					Space x = p->position ();
+					for (int k = 0; k < dimension; k++)
+						q.x[k] = x[k];
+					return q;
+				}
+
+				// send particles which left the slab to the neighbours and
+				// receive theirs, then the same for the ghosts
+				bool exchange ()
+				{
+					out[0].clear ();
+					out[1].clear ();
+					sys->removeParticles ([this] (const Particle * p) -> bool
+						{
+							double x = p->position ()[axis];
+							int d = (x < lo && rank > 0) ? 0 : ((x >= hi && rank < n - 1) ? 1 : -1);
+							if (d < 0)
+								return false;
+							out[d].push_back (record (p, PDL_DOMAIN_MIGRANT));
+							return true;
+						});
+					sharedMigrants[rank] += out[0].size() + out[1].size();
+					if (!transfer ())
+						return false;
+
+					out[0].clear ();
+					out[1].clear ();
+					if (halo > 0.)
+						for (int i = 0; i < sys->getNParticles (); i++)
+						{
+							const Particle * p = sys->getParticle (i);
+							double x = p->position ()[axis];
+							if (rank > 0 && x < lo + halo)
+								out[0].push_back (record (p, PDL_DOMAIN_GHOST));
+							if (rank < n - 1 && x >= hi - halo)
+								out[1].push_back (record (p, PDL_DOMAIN_GHOST));
+						}
+					ghostsys->removeParticles ([] (const Particle *) {return true;});
+					return transfer ();
+				}
+
+				// send out[] to the neighbours and receive their records
+				bool transfer ()
+				{
+					Record end;
+					memset (&end, 0, sizeof (end));
+					end.kind = PDL_DOMAIN_END;
+					out[0].push_back (end);
+					out[1].push_back (end);
+
+					int neighbour[2] = {rank - 1, rank + 1};
+					size_t sent[2] = {0, 0};
+					bool received[2] = {false, false};
+					for (int d = 0; d < 2; d++)
+						if (neighbour[d] < 0 || neighbour[d] >= n)
+						{
+							sent[d] = out[d].size();
+							received[d] = true;
+						}
+
+					// send and receive at the same time, so full rings cannot block
+					while (sent[0] < out[0].size() || sent[1] < out[1].size() || !received[0] || !received[1])
+					{
+						bool progress = false;
+						for (int d = 0; d < 2; d++)
+						{
+							Ring & o = rings[2 * rank + d];
+							while (sent[d] < out[d].size() && o.push (out[d][sent[d]]))
+							{
+								sent[d]++;
+								progress = true;
+							}
+
+							Record q;
+							Ring & in = rings[2 * neighbour[d] + 1 - d];
+							while (!received[d] && in.pop (q))
+							{
+								progress = true;
+								if (q.kind == PDL_DOMAIN_END)
+									received[d] = true;
+								else
+									receive (q);
+							}
+						}
+						if (!progress)
+						{
+							if (cancel->load ())
+								return false;
+							sched_yield ();
+						}
+					}
+					return true;
+				}
+
+				void receive (const Record & q)
+				{
+					Space x;
+					for (int k = 0; k < dimension; k++)
+						x[k] = q.x[k];
+					Particle * p = sys->factory ().createParticle (x, static_cast<Type> (q.type));
+					p->setNumber (q.number);
+					if (q.kind == PDL_DOMAIN_MIGRANT)
+					{
+						p->reseed (q.seed);
+						sys->adoptParticle (p);
+					}
+					else
+						ghostsys->adoptParticle (p);
+				}
+
+				// move the faces towards equal numbers of particles per slab
+				bool balance ()
+				{
+					int nb = n * binsPerSlab;
+					double * h = histograms + static_cast<size_t> (rank) * nb;
+					std::fill (h, h + nb, 0.);
+					for (int i = 0; i < sys->getNParticles (); i++)
+					{
+						int b = static_cast<int> ((sys->getParticle (i)->position ()[axis] - L) / (U - L) * nb);
+						h[std::min (std::max (b, 0), nb - 1)] += 1.;
+					}
+					if (!barrier.wait (cancel))
+						return false;
+
+					// every process computes the same faces from the same sums
+					std::vector<double> c (nb + 1, 0.);
+					for (int b = 0; b < nb; b++)
+					{
+						double s = 0.;
+						for (int r = 0; r < n; r++)
+							s += histograms[static_cast<size_t> (r) * nb + b];
+						c[b + 1] = c[b] + s;
+					}
+					if (!barrier.wait (cancel))
+						return false;
+
+					std::vector<double> f (faces);
+					if (c[nb] > 0.)
+						for (int k = 1; k < n; k++)
+						{
+							double target = c[nb] * k / n;
+							int b = std::upper_bound (c.begin(), c.end(), target) - c.begin() - 1;
+							b = std::min (std::max (b, 0), nb - 1);
+							double w = (c[b + 1] > c[b]) ? (target - c[b]) / (c[b + 1] - c[b]) : 0.5;
+							double x = L + (U - L) * (b + w) / nb;
+							f[k] = std::min (std::max (x, 0.5 * (faces[k - 1] + faces[k])),
+								0.5 * (faces[k] + faces[k + 1]));
+						}
+					faces = f;
+					lo = faces[rank];
+					hi = faces[rank + 1];
+					if (rank == 0)
+						std::copy (faces.begin(), faces.end(), sharedFaces);
+					return true;
+				}
+
+				DomainDecomposition (const DomainDecomposition &);
+		};
+
+}; // namespace PDL
+
+#endif
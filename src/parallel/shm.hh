@@ -0,0 +1,256 @@
+// shm.hh
+// shared memory, ring buffers and barriers for local processes
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_PARALLEL_SHM_HH
+# define PDLIB_PARALLEL_SHM_HH
+
+#include <string>
+#include <sstream>
+#include <atomic>
+#include <new>
+#include <stdexcept>
+#include <cstring>
+#include <stdint.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+
+namespace PDL
+{
+	// POSIX shared memory segment. An anonymous one is inherited by processes
+	// forked after its creation; its name is unlinked right after mapping, so
+	// nothing is left in /dev/shm when the processes exit (or crash). A named
+	// one can be opened read-only by any local process and is unlinked by
+	// its creator when destroyed. Older C libraries need -lrt for shm_open.
+	class SharedMemory
+	{
+		public:
+			// anonymous
+			SharedMemory (size_t length) : base (nullptr), length (length), owner (false)
+			{
+				static int serial = 0;
+				std::ostringstream s;
+				s << "/pdlib-" << getpid () << "-" << serial++;
+				create (s.str());
+				shm_unlink (s.str().c_str());
+			};
+
+			// named, created (replacing an old segment of that name)
+			SharedMemory (const std::string & name, size_t length)
+				: base (nullptr), length (length), name (name), owner (true)
+			{
+				shm_unlink (name.c_str());
+				create (name);
+			};
+
+			// named, opened read-only
+			SharedMemory (const std::string & name) : base (nullptr), length (0), owner (false)
+			{
+				int fd = shm_open (name.c_str(), O_RDONLY, 0);
+				if (fd < 0)
+					throw std::runtime_error ("SharedMemory: cannot open " + name);
+				struct stat st;
+				if (fstat (fd, &st) != 0)
+				{
+					close (fd);
+					throw std::runtime_error ("SharedMemory: cannot stat " + name);
+				}
+				length = st.st_size;
+				base = mmap (nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+				close (fd);
+				if (base == MAP_FAILED)
+					throw std::runtime_error ("SharedMemory: cannot map " + name);
+			};
+
+			~SharedMemory ()
+			{
+				if (base != nullptr)
+					munmap (base, length);
+				if (owner)
+					shm_unlink (name.c_str());
+			}
+
+			void * data () const {return base;};
+			size_t size () const {return length;};
+
+		private:
+			void * base;
+			size_t length;
+			std::string name;
+			bool owner;
+
+			void create (const std::string & name)
+			{
+				int fd = shm_open (name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+				if (fd < 0)
+					throw std::runtime_error ("SharedMemory: cannot create " + name);
+				if (ftruncate (fd, length) != 0)
+				{
+					close (fd);
+					shm_unlink (name.c_str());
+					throw std::runtime_error ("SharedMemory: cannot allocate " + name);
+				}
+				base = mmap (nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+				close (fd);
+				if (base == MAP_FAILED)
+				{
+					shm_unlink (name.c_str());
+					throw std::runtime_error ("SharedMemory: cannot map " + name);
+				}
+			}
+
+			SharedMemory (const SharedMemory &);
+	};
+
+	// Single producer, single consumer ring of records of type T (plain
+	// data) placed in shared memory: the producer only writes the head, the
+	// consumer only the tail, so no locks are needed.
+	template<class T>
+		class ShmRing
+		{
+			public:
+				// bytes needed for a ring of 2^k >= capacity records
+				static size_t bytes (size_t capacity)
+				{
+					return sizeof (Header) + roundUp (capacity) * sizeof (T);
+				}
+
+				// place a new ring at memory (call once, before forking)
+				static ShmRing create (void * memory, size_t capacity)
+				{
+					Header * h = new (memory) Header;
+					h->head.store (0);
+					h->tail.store (0);
+					h->mask = roundUp (capacity) - 1;
+					return ShmRing (memory);
+				}
+
+				ShmRing () : h (nullptr), slot (nullptr) {};
+				ShmRing (void * memory)
+					: h (static_cast<Header*> (memory)),
+					slot (reinterpret_cast<T*> (static_cast<Header*> (memory) + 1)) {};
+
+				// false if the ring is full
+				bool push (const T & x)
+				{
+					uint64_t head = h->head.load (std::memory_order_relaxed);
+					if (head - h->tail.load (std::memory_order_acquire) > h->mask)
+						return false;
+					slot[head & h->mask] = x;
+					h->head.store (head + 1, std::memory_order_release);
+					return true;
+				}
+
+				// false if the ring is empty
+				bool pop (T & x)
+				{
+					uint64_t tail = h->tail.load (std::memory_order_relaxed);
+					if (tail == h->head.load (std::memory_order_acquire))
+						return false;
+					x = slot[tail & h->mask];
+					h->tail.store (tail + 1, std::memory_order_release);
+					return true;
+				}
+
+				size_t capacity () const {return h->mask + 1;};
+
+				// write the slots from the consumer first, so that on a NUMA
+				// node they are allocated close to it
+				void touch () {memset (slot, 0, capacity () * sizeof (T));};
+
+			private:
+				struct Header
+				{
+					alignas(64) std::atomic<uint64_t> head;
+					alignas(64) std::atomic<uint64_t> tail;
+					uint64_t mask;
+				};
+
+				Header * h;
+				T * slot;
+
+				static size_t roundUp (size_t n)
+				{
+					size_t m = 1;
+					while (m < n)
+						m *= 2;
+					return m;
+				}
+		};
+
+	// Sense reversing barrier for n processes in shared memory; the
+	// processes spin (yielding the CPU), as the waits are short. A wait is
+	// given up (returning false) once *cancel is set
+	class ShmBarrier
+	{
+		public:
+			static size_t bytes () {return sizeof (State);};
+
+			static ShmBarrier create (void * memory, int n)
+			{
+				State * s = new (memory) State;
+				s->n = n;
+				s->waiting.store (0);
+				s->sense.store (0);
+				return ShmBarrier (memory);
+			}
+
+			ShmBarrier () : s (nullptr), sense (0) {};
+			ShmBarrier (void * memory) : s (static_cast<State*> (memory)), sense (0) {};
+
+			bool wait (const std::atomic<int> * cancel = nullptr)
+			{
+				sense = 1 - sense;
+				if (s->waiting.fetch_add (1) == s->n - 1)
+				{
+					s->waiting.store (0);
+					s->sense.store (sense, std::memory_order_release);
+				}
+				else
+					while (s->sense.load (std::memory_order_acquire) != sense)
+					{
+						if (cancel && cancel->load ())
+							return false;
+						sched_yield ();
+					}
+				return true;
+			}
+
+		private:
+			struct State
+			{
+				int n;
+				alignas(64) std::atomic<int> waiting;
+				alignas(64) std::atomic<int> sense;
+			};
+
+			State * s;
+			int sense; // local sense of this process
+	};
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,144 @@
+/* testDomains.cc  2015-08-14 slab decomposition across local processes
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <random>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/parallel/domains.hh>
+
+typedef PDL::GeometryBox<double, 2> Box;
+typedef PDL::SpeciesFactory<Box> Factory;
+typedef PDL::CompiledNetwork<Box> Rxn;
+typedef PDL::System<Box, Factory, Rxn> Sys;
+
+int main (int argc, char ** argv)
+{
+	PDL::Random::seed (1);
+
+	Box::Space x0 (0.), H (20.);
+	Box b (x0, H);
+	double dt = 0.05;
+	int nsteps = 4000;
+
+	// genes clustered at the left wall make mRNA; tracers only diffuse
+	double km = 0.5, kdeg = 0.05;
+	PDL::ReactionNetwork net;
+	int gene = net.addSpecies ("Gene", 0.);
+	int mrna = net.addSpecies ("mRNA", 1.);
+	int tracer = net.addSpecies ("Tracer", 1.);
+	net.produce (gene, mrna, km);
+	net.decay (mrna, kdeg);
+	Factory F (net, dt);
+
+	int ngenes = 50, ntracers = 2000;
+	double expected = ngenes * (1. - exp (- km * dt)) / (1. - exp (- kdeg * dt));
+
+	for (int balance = 0; balance <= 20; balance += 20)
+	{
+		PDL::DomainDecomposition<Sys> dd (4, b.lower (), b.upper ());
+		dd.setHalo (0.5);
+		dd.setBalancing (balance);
+		// counts, ghosts, particles seen (with the ghosts) around the two
+		// faces, and the sum of the numbers of the tracers
+		dd.setObservable (7, [&] (const Sys & s, double * row)
+			{
+				row[0] = s.getNParticles (gene);
+				row[1] = s.getNParticles (mrna);
+				row[2] = s.getNParticles (tracer);
+				row[3] = dd.ghosts().getNParticles ();
+				for (int side = 0; side < 2; side++)
+				{
+					Box::Space lo = b.lower (), hi = b.upper ();
+					double f = side ? dd.slabUpper () : dd.slabLower ();
+					lo[0] = f - 0.5;
+					hi[0] = f + 0.5;
+					row[4 + side] = dd.countInBox (lo, hi);
+				}
+				row[6] = 0.;
+				for (int i = 0; i < s.getNParticles (); i++)
+					if (s.getParticle (i)->type () == tracer)
+						row[6] += s.getParticle (i)->getNumber ();
+			}, 100);
+
+		// every process makes the same configuration and keeps its own part
+		auto make = [&] (int rank) -> Sys *
+		{
+			Sys * s = new Sys (b, F);
+			s->addReaction (Rxn (net, F, b));
+			std::mt19937 engine (2);
+			std::uniform_real_distribution<double> u (0., 1.);
+			for (int i = 0; i < ngenes; i++)
+			{
+				Box::Space x = b.randomPoint (engine);
+				x[0] = -10. + 3. * u (engine);
+				if (dd.owns (x))
+					s->addParticle (x, gene);
+			}
+			for (int i = 0; i < ntracers; i++)
+			{
+				Box::Space x = b.randomPoint (engine);
+				if (dd.owns (x))
+					s->addParticle (x, tracer);
+			}
+			return s;
+		};
+
+		if (!dd.run (make, nsteps, dt))
+		{
+			std::cerr << "run failed" << std::endl;
+			return 0;
+		}
+
+		// particles are neither lost nor duplicated on the way, migrants
+		// keep their numbers, and neighbours see the same particles around
+		// their common face
+		int renumbered = 0, differ = 0;
+		for (int k = 0; k < dd.nSamples (); k++)
+		{
+			std::vector<double> s = dd.sample (k);
+			if (s[0] != ngenes || s[2] != ntracers)
+				std::cerr << "t = " << dd.sampleTime (k) << ": " << s[0] << " genes, "
+					<< s[2] << " tracers" << std::endl;
+			if (s[6] != dd.sample (0)[6])
+				renumbered++;
+			for (int r = 0; r + 1 < dd.nDomains (); r++)
+				if (dd.sample (k, r, 5) != dd.sample (k, r + 1, 4))
+					differ++;
+		}
+		std::cerr << "tracer numbers changed in " << renumbered << " samples, views of the faces differ in "
+			<< differ << std::endl;
+
+		// stationary mRNA number over the second half
+		double m = 0.;
+		int ns = 0;
+		for (int k = dd.nSamples () / 2; k < dd.nSamples (); k++, ns++)
+			m += dd.sample (k)[1];
+		std::cerr << (balance ? "balanced" : "fixed") << " slabs: mRNA " << m / ns
+			<< " (" << expected << "), " << dd.migrants () << " migrants, "
+			<< dd.sample (dd.nSamples () - 1)[3] << " ghosts" << std::endl;
+		for (int r = 0; r < dd.nDomains (); r++)
+			std::cerr << "    [" << dd.face (r) << ", " << dd.face (r + 1) << "): "
+				<< dd.particles (r) << " particles" << std::endl;
+	}
+
+	return 1;
+}
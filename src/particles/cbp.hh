@@ -0,0 +1,153 @@
+// cbp.hh
+// point-like Brownian particle in a multi-compartment geometry
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_CBP_HH
+# define PDLIB_CBP_HH
+
+#include <fstream>
+
+#include <chrono>
+#include <random>
+
+#include <pdlib/random.hh>
+#include <pdlib/geom/boundary.hh>
+
+#ifndef MAX_ATTEMPT
+#define MAX_ATTEMPT 100
+#endif
+
+namespace PDL
+{
+	// Brownian particle taking its diffusion coefficient from the compartment
+	// it is in (see GeometryComposite). The compartment is cached and looked
+	// up from the old one after a move; a move into another compartment is
+	// accepted with the transfer probability of the membrane for this time
+	// step, otherwise the particle stays where it is.
+	template<class Geometry>
+		class CompartmentParticle
+		{
+
+			public:
+				typedef typename Geometry::Space Space;
+				typedef typename Geometry::type ctype;
+
+				CompartmentParticle (const Space & x, Geometry & g, double dt, int type = -1)  :
+					x(x), dt(dt), t (type), number(-1), absorbed_ (false), c (-1),
+					engine (Random::next ()),
+					distribution (0, 1)
+				{
+					enter (g.compartment (x), g);
+				};
+
+				int type () const {return t;};
+				int compartment () const {return c;};
+
+				bool move (const double dt, Geometry & g)
+				{
+					if (dt != this->dt)
+					{
+						std::cerr << "Cannot move: Time step must be the same" << std::endl;
+						return false;
+					}
+
+					for (int attempt = 0; attempt < MAX_ATTEMPT; attempt++)
+					{
+						Space xnew = x;
+						for (int i = 0; i < Geometry::dimension; i++)
+							xnew[i] += s * distribution (engine);
+
+						if (g.boundary() != PDL_BOUNDARY_REJECTING && g.boundary() != PDL_BOUNDARY_REFLECTING)
+						{
+							double p = contactProbability (g, x, xnew, D, dt);
+							if (p > 0. && uniform (engine) < p
+								&& uniform (engine) < g.absorptionProbability (D, dt))
+							{
+								absorbed_ = true;
+								return true;
+							}
+						}
+
+						if (!g.inside (xnew))
+						{
+							if (g.boundary() == PDL_BOUNDARY_REJECTING)
+								continue;
+							g.reflect (xnew);
+						}
+
+						int cnew = g.compartment (xnew, c);
+						if (cnew != c)
+						{
+							double p = g.transferProbability (c, cnew, dt);
+							if (p < 1. && !(uniform (engine) < p))
+								return true; // the membrane reflects
+							enter (cnew, g);
+						}
+						x = xnew;
+						return true;
+					}
+					return false;
+				};
+
+				Space position () const {return x;};
+				bool absorbed () const {return absorbed_;};
+				double getDt () {return dt;};
+				double getD () {return D;};
+
+				void print (std::ofstream * stream)
+				{
+					*stream << position() << " " << c << std::endl;
+				}
+
+				void setNumber (int64_t n) {number = n;} ;
+				int64_t getNumber (void) const { return number;} ;
+
+				std::mt19937 & randomEngine () {return engine;};
+				void reseed (uint64_t seed) {engine.seed (seed);};
+
+			private:
+
+				Space  x;
+				double dt;
+				double D; // of the current compartment
+				double s;
+
+				const int t; // type
+				int64_t number;
+				bool absorbed_;
+				int c; // current compartment
+
+				std::mt19937 engine;
+				std::normal_distribution<ctype>  distribution;
+				std::uniform_real_distribution<double> uniform;
+
+				void enter (int cnew, const Geometry & g)
+				{
+					c = cnew;
+					D = g.diffusion (c);
+					s = sqrt (2. * D * dt);
+				}
+		};
+
+}; // namespace PDL
+
+#endif
@@ -28,32 +28,43 @@
 
 #include <chrono>
 #include <random>
+#include <type_traits>
+
+#include <pdlib/random.hh>
+#include <pdlib/geom/boundary.hh>
+#include <pdlib/instances.hh>
+#ifdef PDL_EXTERN_TEMPLATES
+#include <pdlib/geom/box.hh>
+#endif
 
 #define MAX_ATTEMPT 100
 
 namespace PDL
 {
+	// Coordinates are of Geometry::type (float or double); the time step,
+	// diffusion coefficient and everything accumulated over time stay double
 	template<class Geometry>
 		class BrownianParticle
 		{
 
 			public:
 				typedef typename Geometry::Space Space;
+				typedef typename Geometry::type ctype;
 
 				BrownianParticle (const Space & x, double D, double dt)  : 
-					x(x), D(D), dt(dt), s(sqrt (2. * D * dt)), t (-1), number(-1),
-					engine (std::chrono::system_clock::now().time_since_epoch().count()),
-					distribution (0, s)
+					x(x), D(D), dt(dt), s(sqrt (2. * D * dt)), t (-1), number(-1), absorbed_ (false),
+					engine (Random::next ()),
+					distribution (0, (s > 0.) ? s : 1.)
 				{
-					static_assert(std::is_same<typename Geometry::type, double>::value, "only double supported");
+					static_assert(std::is_floating_point<typename Geometry::type>::value, "floating point coordinates required");
 				};
 
 				BrownianParticle (const Space & x, double D, double dt, int type)  : 
-					x(x), D(D), dt(dt), s(sqrt (2. * D * dt)), t (type), number(-1),
-					engine (std::chrono::system_clock::now().time_since_epoch().count()),
-					distribution (0, s)
+					x(x), D(D), dt(dt), s(sqrt (2. * D * dt)), t (type), number(-1), absorbed_ (false),
+					engine (Random::next ()),
+					distribution (0, (s > 0.) ? s : 1.)
 				{
-					static_assert(std::is_same<typename Geometry::type, double>::value, "only double supported");
+					static_assert(std::is_floating_point<typename Geometry::type>::value, "floating point coordinates required");
 				};
 
 				int type () const {return t;};
@@ -63,43 +74,21 @@ namespace PDL
 					return move (dt, g);
 				}
 
-				bool move (const double dt, Geometry & g)
-				{
-					if (dt != this->dt)
-					{
-						std::cerr << "Cannot move: Time step must be the same" << std::endl;
-						return false;
-					}
-#ifdef DEBUG		
-					std::cerr << "mean=" << distribution.mean() << ", std=" << distribution.stddev() << std::endl;
-#endif
-					Space xnew = x;
-					for (int attempt = 0; attempt < MAX_ATTEMPT; attempt++)
-					{
-						for (int i = 0; i < Geometry::dimension; i++)
-						{
-							double a =  distribution (engine);
-#ifdef DEBUG					
-							std::cerr << "dX" << i << "=" << a << std::endl;
-#endif					
-							xnew[i] += a;
-						}
-
-						if (g.inside(xnew))
-						{
-							x = xnew;
-#ifdef DEBUG
-							std::cerr << "x=" << x 
-								<< " xnew=" << xnew << std::endl;
-#endif
-							return true;
-						} 
-					}
-					return false;
-				};
+				// one Brownian step; defined below the class, as is the rest of
+				// the hot path, so that with PDL_EXTERN_TEMPLATES the optimised
+				// instance in libpdlib is used (see instances.hh)
+				bool move (const double dt, Geometry & g);
 
 				Space position () const {return x;};
+				// for event driven engines, which move particles themselves
+				void setPosition (const Space & y) {x = y;};
+
+				// the particle hit an absorbing boundary and must be removed by the system
+				bool absorbed () const {return absorbed_;};
 				double getDt () {return dt;};
+				double getD () const {return D;};
+				// never moves: kept in the static tier of a System
+				bool immobile () const {return D == 0.;};
 
 				void print (const std::string & name)
 				{
@@ -120,8 +109,12 @@ namespace PDL
 					*stream << position() << std::endl;
 				}
 
-				void setNumber (int n) {number = n;} ;
-				int getNumber (void) const { return number;} ;
+				// the particle's own random engine, e.g., for its reactions
+				std::mt19937 & randomEngine () {return engine;};
+				void reseed (uint64_t seed) {engine.seed (seed);};
+
+				void setNumber (int64_t n) {number = n;} ;
+				int64_t getNumber (void) const { return number;} ;
 
 			private:
 
@@ -131,12 +124,92 @@ namespace PDL
 				double s;
 
 				const int t; // type
-				int number; // particle number in a system, set by a system (FIXME: make friends?)
+				int64_t number; // particle number in a system, set by a system (FIXME: make friends?)
+				bool absorbed_;
 
 				std::mt19937 engine;
-				std::normal_distribution<typename Geometry::type>  distribution;
+				std::normal_distribution<ctype>  distribution;
+				std::uniform_real_distribution<double> uniform;
+
+				// move with reflecting, absorbing or reactive boundaries;
+				// contacts with an absorbing boundary within the step are
+				// detected with the Brownian bridge, so that the step may be
+				// large compared to the distance to the boundary (see
+				// contactProbability for the reactive boundary)
+				bool moveBoundary (Geometry & g);
 		};
 
+	template<class Geometry>
+	bool BrownianParticle<Geometry>::move (const double dt, Geometry & g)
+	{
+		if (dt != this->dt)
+		{
+			std::cerr << "Cannot move: Time step must be the same" << std::endl;
+			return false;
+		}
+		if (D == 0.) // immobile
+			return true;
+#ifdef DEBUG		
+		std::cerr << "mean=" << distribution.mean() << ", std=" << distribution.stddev() << std::endl;
+#endif
+		if (g.boundary() != PDL_BOUNDARY_REJECTING)
+			return moveBoundary (g);
+
+		for (int attempt = 0; attempt < MAX_ATTEMPT; attempt++)
+		{
+			Space xnew = x;
+			for (int i = 0; i < Geometry::dimension; i++)
+			{
+				ctype a =  distribution (engine);
+#ifdef DEBUG					
+				std::cerr << "dX" << i << "=" << a << std::endl;
+#endif					
+				xnew[i] += a;
+			}
+
+			if (g.inside(xnew))
+			{
+				x = xnew;
+#ifdef DEBUG
+				std::cerr << "x=" << x 
+					<< " xnew=" << xnew << std::endl;
+#endif
+				return true;
+			} 
+		}
+		return false;
+	}
+
+	template<class Geometry>
+	bool BrownianParticle<Geometry>::moveBoundary (Geometry & g)
+	{
+		Space xnew = x;
+		for (int i = 0; i < Geometry::dimension; i++)
+			xnew[i] += distribution (engine);
+
+		if (g.boundary() != PDL_BOUNDARY_REFLECTING)
+		{
+			double p = contactProbability (g, x, xnew, D, dt);
+			if (p > 0. && uniform (engine) < p
+				&& uniform (engine) < g.absorptionProbability (D, dt))
+			{
+				absorbed_ = true;
+				return true;
+			}
+		}
+
+		if (!g.inside (xnew))
+			g.reflect (xnew);
+		x = xnew;
+		return true;
+	}
+
+#ifdef PDL_EXTERN_TEMPLATES
+#define PDL_EXTERN(ctype, dim) extern template class BrownianParticle<GeometryBox<ctype, dim> >;
+	PDL_INSTANCES (PDL_EXTERN)
+#undef PDL_EXTERN
+#endif
+
 }; // namespace PDL
 
 #endif
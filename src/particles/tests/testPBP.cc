@@ -18,6 +18,7 @@
  */
 
 #include <iostream>
+#include <cmath>
 
 #include "pdlib/geom/box.hh"
 #include "pdlib/particles/pbp.hh"
@@ -44,6 +45,47 @@ int main (int argc, char ** argv)
 		std::cout << p.position () << std::endl;
 	}
 
+	// single precision coordinates
+	Dune::FieldVector<float, 2> y0 (0.f);
+	Dune::FieldVector<float, 2> L (10.f);
+
+	typedef PDL::GeometryBox<float, 2> BoxF;
+	BoxF bf (y0, L);
+
+	PDL::BrownianParticle<BoxF> q (y0, 0.1, dt);
+	for (int i =0; i < 100; i++)
+	{
+		q.move (dt, bf);
+		std::cout << q.position () << std::endl;
+	}
+
+	// Rejected moves are redrawn from the old position, so that with steps
+	// (s = 0.5) as large as a unit box no move fails. Redrawing makes the
+	// density proportional to the probability Z (x) that a step from x
+	// stays inside, so <x^2> is a bit below 1/12
+	Dune::FieldVector<double, 2> unit (1.);
+	Box small (x0, unit);
+	double s = 0.5;
+	PDL::BrownianParticle<Box> r (x0, s * s / 2., 1.);
+	int failed = 0, n = 100000;
+	double x2 = 0.;
+	for (int i = 0; i < n; i++)
+	{
+		if (!r.move (1., small))
+			failed++;
+		x2 += r.position ()[0] * r.position ()[0];
+	}
+	double z = 0., zx2 = 0.;
+	for (int i = 0; i < 1000; i++)
+	{
+		double y = -0.5 + (i + 0.5) / 1000.;
+		double Z = 0.5 * (erf ((0.5 - y) / (s * sqrt (2.))) - erf ((-0.5 - y) / (s * sqrt (2.))));
+		z += Z;
+		zx2 += y * y * Z;
+	}
+	std::cerr << "rejecting box: " << failed << " failed moves, <x^2> = " << x2 / n
+		<< " (" << zx2 / z << ")" << std::endl;
+
 	return 1;
 }
 
@@ -0,0 +1,62 @@
+// pdlib.cc
+// explicit instantiations compiled into libpdlib, see instances.hh
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#include <pdlib/instances.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/particles/pbp.hh>
+#include <pdlib/mingen/gene.hh>
+#include <pdlib/mingen/mingen.hh>
+#include <pdlib/observables/observables.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/system.hh>
+
+namespace PDL
+{
+#define PDL_INSTANTIATE(ctype, dim) \
+	template class GeometryBox<ctype, dim>; \
+	template class BrownianParticle<GeometryBox<ctype, dim> >; \
+	template class MinGen::mRNA<GeometryBox<ctype, dim> >; \
+	template class MinGen::Gene<GeometryBox<ctype, dim> >; \
+	template class SpeciesParticle<GeometryBox<ctype, dim> >; \
+	template class SpeciesFactory<GeometryBox<ctype, dim> >; \
+	template class CompiledNetwork<GeometryBox<ctype, dim> >; \
+	template class CellList<GeometryBox<ctype, dim>, SpeciesParticle<GeometryBox<ctype, dim> > >; \
+	template class System<GeometryBox<ctype, dim>, SpeciesFactory<GeometryBox<ctype, dim> >, \
+		CompiledNetwork<GeometryBox<ctype, dim> > >;
+
+	PDL_INSTANCES (PDL_INSTANTIATE)
+
+#undef PDL_INSTANTIATE
+}; // namespace PDL
+
+// the MinGen model of mingen/tests
+#define PDL_INSTANTIATE(ctype, dim) \
+	template class MinGenParticle<PDL::GeometryBox<ctype, dim> >; \
+	template class MinGenFactory<PDL::GeometryBox<ctype, dim> >; \
+	template class MinGenReaction<PDL::GeometryBox<ctype, dim> >; \
+	template class PDL::CellList<PDL::GeometryBox<ctype, dim>, MinGenParticle<PDL::GeometryBox<ctype, dim> > >; \
+	PDL_MINGEN_MEMBERS (, ctype, dim)
+
+PDL_INSTANCES (PDL_INSTANTIATE)
+
+#undef PDL_INSTANTIATE
@@ -0,0 +1,131 @@
+// random.hh
+// seeds for the random number generators of PDL
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_RANDOM_HH
+# define PDLIB_RANDOM_HH
+
+#include <cstdlib>
+#include <chrono>
+#include <atomic>
+#include <stdint.h>
+
+namespace PDL
+{
+	// All engines (particles, reactions, bulk insertion) take their seeds
+	// from one splitmix64 stream, and rand() is seeded from the same seed.
+	// Without an explicit seed everything is seeded from the clock as before;
+	// with Random::seed (s) a run is reproducible, and runs with the same
+	// seed share their random numbers (common random numbers). next () may
+	// be called from several threads, but then the order of the seeds is
+	// not reproducible: parallel code derives its seeds from its own engines,
+	// or opens a Stream of its own on each thread.
+	class Random
+	{
+		public:
+			// While a Stream is alive, next () on its thread draws from the
+			// stream instead of the shared state: engines created there,
+			// e.g., by particle constructors, are seeded once and
+			// reproducibly whichever thread runs the code
+			class Stream
+			{
+				public:
+					Stream (uint64_t s) : state (s), previous (local ()) {local () = this;};
+					~Stream () {local () = previous;};
+
+				private:
+					uint64_t state;
+					Stream * previous;
+
+					Stream (const Stream &);
+					friend class Random;
+			};
+
+			static void seed (uint64_t s)
+			{
+				state ().store (s);
+				seeded () = true;
+				srand (static_cast<unsigned int> (s));
+			}
+
+			// seed rand() from the clock unless seeded explicitly
+			// (called by geometries on construction)
+			static void init ()
+			{
+				if (!seeded ())
+					srand (static_cast<unsigned int> (clock ()));
+			}
+
+			// next seed for a new random engine
+			static uint64_t next ()
+			{
+				Stream * l = local ();
+				if (l != nullptr)
+					return mix (l->state += 0x9e3779b97f4a7c15ULL);
+
+				std::atomic<uint64_t> & s = state ();
+				if (!seeded ())
+				{
+					uint64_t zero = 0;
+					s.compare_exchange_strong (zero, clock ());
+				}
+				return mix (s.fetch_add (0x9e3779b97f4a7c15ULL) + 0x9e3779b97f4a7c15ULL);
+			}
+
+			// splitmix64 finaliser, e.g., to derive seeds from other seeds
+			static uint64_t mix (uint64_t z)
+			{
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+				return z ^ (z >> 31);
+			}
+
+			static bool isSeeded () {return seeded ();};
+
+		private:
+			static std::atomic<uint64_t> & state ()
+			{
+				static std::atomic<uint64_t> s (0);
+				return s;
+			}
+
+			static Stream * & local ()
+			{
+				static thread_local Stream * l = nullptr;
+				return l;
+			}
+
+			static bool & seeded ()
+			{
+				static bool b = false;
+				return b;
+			}
+
+			static uint64_t clock ()
+			{
+				return std::chrono::system_clock::now().time_since_epoch().count();
+			}
+	};
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,343 @@
+// network.hh
+// declarative first order reaction networks
+//
+// This file is part of Particle Dynamic Library (PDL),
+// a templeted library for particle dynamic
+//
+// Copyright (C) 2015 Valiska @ FZJ
+//
+// This program is free software; you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation; either version 2 of the License, or (at
+// your option) any later version.
+//
+// This program is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+//
+
+#ifndef PDLIB_REACTIONS_NETWORK_HH
+# define PDLIB_REACTIONS_NETWORK_HH
+
+#include <vector>
+#include <string>
+#include <stdexcept>
+#include <cmath>
+
+#include <chrono>
+#include <random>
+
+#include <pdlib/random.hh>
+#include <pdlib/particles/pbp.hh>
+
+namespace PDL
+{
+	// where the products of a reaction are put
+	typedef enum {
+		PDL_PLACE_PARENT,   // at the position of the reactant
+		PDL_PLACE_UNIFORM,  // anywhere in the geometry
+		PDL_PLACE_GAUSSIAN  // around the reactant with standard deviation sigma
+	} Placement;
+
+	// Description of species (with their diffusion coefficients) and first
+	// order reactions A -> products with rate constants k. A reaction keeps
+	// the reactant if it appears among the products (e.g., A -> A + B).
+	class ReactionNetwork
+	{
+		public:
+			struct Reaction
+			{
+				int reactant;
+				std::vector<int> products;
+				double k;
+				Placement place;
+				double sigma;
+			};
+
+			int addSpecies (const std::string & name, double D)
+			{
+				names.push_back (name);
+				Ds.push_back (D);
+				return names.size() - 1;
+			}
+
+			int addReaction (int reactant, const std::vector<int> & products, double k,
+				Placement place = PDL_PLACE_PARENT, double sigma = 0.)
+			{
+				check (reactant);
+				for (unsigned int i = 0; i < products.size(); i++)
+					check (products[i]);
+
+				Reaction r;
+				r.reactant = reactant;
+				r.products = products;
+				r.k = k;
+				r.place = place;
+				r.sigma = sigma;
+				rxns.push_back (r);
+				return rxns.size() - 1;
+			}
+
+			// A -> 0
+			int decay (int A, double k)
+			{
+				return addReaction (A, std::vector<int> (), k);
+			}
+
+			// A -> B
+			int convert (int A, int B, double k)
+			{
+				return addReaction (A, std::vector<int> (1, B), k);
+			}
+
+			// A -> A + B
+			int produce (int A, int B, double k, Placement place = PDL_PLACE_PARENT, double sigma = 0.)
+			{
+				std::vector<int> p;
+				p.push_back (A);
+				p.push_back (B);
+				return addReaction (A, p, k, place, sigma);
+			}
+
+			int nSpecies () const {return names.size();};
+			int nReactions () const {return rxns.size();};
+			const std::string & name (int s) const {return names.at (s);};
+			double diffusion (int s) const {return Ds.at (s);};
+			const Reaction & reaction (int r) const {return rxns.at (r);};
+
+		private:
+			std::vector<std::string> names;
+			std::vector<double> Ds;
+			std::vector<Reaction> rxns;
+
+			void check (int s) const
+			{
+				if (s < 0 || s >= nSpecies())
+					throw std::out_of_range ("ReactionNetwork: unknown species");
+			}
+	};
+
+	// A Brownian particle of a network species; immobile if D = 0
+	template<class Geometry>
+		class SpeciesParticle : public BrownianParticle<Geometry>
+		{
+			public:
+				SpeciesParticle (const typename Geometry::Space & x, double D, double dt, int species)
+					: BrownianParticle<Geometry> (x, D, dt, species) {};
+
+				// particles consumed by a reaction are always deleted
+				bool remove () const {return true;};
+		};
+
+	template<class Geometry>
+		class SpeciesFactory
+		{
+			public:
+				typedef SpeciesParticle<Geometry> Particle;
+
+				SpeciesFactory (const ReactionNetwork & net, double dt)
+					: net (net), dt (dt) {};
+
+				Particle * createParticle (const typename Geometry::Space & x, int species) const
+				{
+					return new Particle (x, net.diffusion (species), dt, species);
+				}
+
+				const ReactionNetwork & network () const {return net;};
+				double getDt () const {return dt;};
+
+			private:
+				const ReactionNetwork & net;
+				const double dt;
+		};
+
+	// The network compiled into a first order Reaction for System: reactions
+	// are grouped by reactant species, and the probability that a particle
+	// reacts within dt, 1 - exp (- sum k dt), as well as the branching ratios
+	// are tabulated once per dt. A particle then costs one table lookup and
+	// one random number, whatever the number of reactions.
+	//
+	// Random numbers come from the reacting particle's engine: a reaction
+	// takes the same three draws every step whether the particle reacts or
+	// not, and products are seeded from these draws. So every lineage of
+	// particles has its own random stream, which does not depend on what
+	// happens elsewhere. The same engine drives the particle's moves, which
+	// take a variable number of draws (rejected steps, crossings), so runs
+	// with common random numbers (ensemble/sweep.hh) only partly stay in
+	// step when a parameter changes.
+	template<class Geometry, class Factory = SpeciesFactory<Geometry> >
+		class CompiledNetwork
+		{
+			public:
+				const int order = 1;
+				typedef typename Factory::Particle Particle;
+
+				CompiledNetwork (const ReactionNetwork & net, const Factory & F, Geometry & geo)
+					: F(F), geo(geo), cached (-1.), last (-1)
+				{
+					first.assign (net.nSpecies() + 1, 0);
+					for (int s = 0; s < net.nSpecies(); s++)
+					{
+						first[s] = channels.size();
+						for (int r = 0; r < net.nReactions(); r++)
+						{
+							const ReactionNetwork::Reaction & rxn = net.reaction (r);
+							if (rxn.reactant != s)
+								continue;
+
+							Channel c;
+							c.id = r;
+							c.k = rxn.k;
+							c.place = rxn.place;
+							c.sigma = rxn.sigma;
+							c.keep = false;
+							for (unsigned int i = 0; i < rxn.products.size(); i++)
+							{
+								// the first copy of the reactant among the products is the reactant itself
+								if (!c.keep && rxn.products[i] == s)
+									c.keep = true;
+								else
+									c.products.push_back (rxn.products[i]);
+							}
+							channels.push_back (c);
+						}
+					}
+					first[net.nSpecies()] = channels.size();
+					ktot.assign (net.nSpecies(), 0.);
+					for (int s = 0; s < net.nSpecies(); s++)
+						for (int c = first[s]; c < first[s + 1]; c++)
+							ktot[s] += channels[c].k;
+					prob.assign (net.nSpecies(), 0.);
+				};
+
+				// tabulate reaction probabilities for the time step dt
+				void compile (double dt);
+
+				// returns true if the particle was consumed
+				bool apply (Particle * p, double dt, std::vector<Particle*> * l);
+
+				// reaction (as numbered in the ReactionNetwork) which fired last
+				int lastReaction () const {return last;};
+
+				// total rate constant of the reactions of species s (0 for
+				// types outside the network)
+				double rate (int s) const
+				{
+					return (s >= 0 && s < static_cast<int> (ktot.size())) ? ktot[s] : 0.;
+				}
+
+			private:
+				struct Channel
+				{
+					int id; // reaction in the network
+					double k;
+					double cum; // cumulative probability within the species
+					bool keep; // the reactant survives
+					std::vector<int> products;
+					Placement place;
+					double sigma;
+				};
+
+				const Factory & F;
+				Geometry & geo;
+
+				std::vector<Channel> channels; // grouped by reactant species
+				std::vector<int> first; // first channel of each species
+				std::vector<double> ktot;
+				std::vector<double> prob;
+				double cached; // dt the tables are for
+				int last;
+
+				typename Geometry::Space place (const typename Geometry::Space & x, const Channel & ch, std::mt19937 & engine);
+		};
+
+	template<class Geometry, class Factory>
+	void CompiledNetwork<Geometry, Factory>::compile (double dt)
+	{
+		for (unsigned int s = 0; s < ktot.size(); s++)
+		{
+			// species whose channels all have k = 0 never react
+			prob[s] = (ktot[s] > 0.) ? 1. - exp (- ktot[s] * dt) : 0.;
+			double cum = 0.;
+			for (int c = first[s]; c < first[s + 1]; c++)
+			{
+				if (ktot[s] > 0.)
+					cum += channels[c].k / ktot[s];
+				channels[c].cum = prob[s] * cum;
+			}
+			if (first[s + 1] > first[s])
+				channels[first[s + 1] - 1].cum = prob[s]; // no round-off gap
+		}
+		cached = dt;
+	}
+
+	template<class Geometry, class Factory>
+	bool CompiledNetwork<Geometry, Factory>::apply (Particle * p, double dt, std::vector<Particle*> * l)
+	{
+		if (dt != cached)
+			compile (dt);
+
+		int s = p->type ();
+		if (s < 0 || s >= static_cast<int> (prob.size()))
+			return false; // not a species of the network
+		std::mt19937 & engine = p->randomEngine ();
+		double r = (engine () + 0.5) / 4294967296.;
+		uint64_t seed = (static_cast<uint64_t> (engine ()) << 32) | engine ();
+		if (!(r < prob[s]))
+			return false;
+
+		int c = first[s];
+		while (channels[c].cum <= r)
+			c++;
+
+		const Channel & ch = channels[c];
+		for (unsigned int i = 0; i < ch.products.size(); i++)
+		{
+			std::mt19937 child (Random::mix (seed + i));
+			Particle * q = F.createParticle (place (p->position(), ch, child), ch.products[i]);
+			q->reseed (child ());
+			l->push_back (q);
+		}
+		last = ch.id;
+		return !ch.keep;
+	}
+
+	template<class Geometry, class Factory>
+	typename Geometry::Space CompiledNetwork<Geometry, Factory>::place (const typename Geometry::Space & x, const Channel & ch, std::mt19937 & engine)
+	{
+		switch (ch.place)
+		{
+			case PDL_PLACE_UNIFORM:
+				return geo.randomPoint (engine);
+			case PDL_PLACE_GAUSSIAN:
+			{
+				std::normal_distribution<double> normal (0., ch.sigma);
+				typename Geometry::Space y = x;
+				for (int i = 0; i < Geometry::dimension; i++)
+					y[i] += normal (engine);
+				if (!geo.inside (y))
+					geo.reflect (y);
+				return y;
+			}
+			default:
+				return x;
+		}
+	}
+
+#ifdef PDL_EXTERN_TEMPLATES
+#define PDL_EXTERN(ctype, dim) \
+	extern template class SpeciesParticle<GeometryBox<ctype, dim> >; \
+	extern template class SpeciesFactory<GeometryBox<ctype, dim> >; \
+	extern template class CompiledNetwork<GeometryBox<ctype, dim> >;
+	PDL_INSTANCES (PDL_EXTERN)
+#undef PDL_EXTERN
+#endif
+
+}; // namespace PDL
+
+#endif
@@ -0,0 +1,88 @@
+/* test-network.cc  2015-07-20 MinGen model as a declarative reaction network
+ *
+ * Units: [D] = mu2/s, [k] = 1/s
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/observables/observables.hh>
+
+int main (int argc, char ** argv) 
+{
+	typedef PDL::GeometryBox<double, 2> Box;
+	Dune::FieldVector<double, 2> x0 (0.), H (2.);
+	Box b (x0,H);
+
+	double dt = .1;
+	double kon = 0.01, koff = 0.01;
+	double kmbasal = 0.02, km = 0.2;
+	double kdeg = 0.01;
+
+	PDL::ReactionNetwork net;
+	int off = net.addSpecies ("GeneOff", 0.);
+	int on = net.addSpecies ("GeneOn", 0.);
+	int mrna = net.addSpecies ("mRNA", 0.01);
+	net.convert (off, on, kon);
+	net.convert (on, off, koff);
+	net.produce (off, mrna, kmbasal);
+	net.produce (on, mrna, km);
+	net.decay (mrna, kdeg);
+
+	typedef PDL::SpeciesFactory<Box> Factory;
+	typedef PDL::CompiledNetwork<Box> Rxn;
+	typedef PDL::Observables<Box> Obs;
+
+	Factory F (net, dt);
+	PDL::System<Box, Factory, Rxn, Obs> system (b, F);
+	system.addReaction (Rxn (net, F, b));
+	system.addParticle (x0, off);
+
+	Obs obs (60., 100, 200, 10);
+	obs.addSpecies (mrna);
+	obs.addSpecies (on);
+	system.addObserver (&obs);
+
+	int N = rint (10*60*60 / dt);
+	for (int i = 0; i < N; i++)
+		system.evolve (dt);
+
+	double pon = kon / (kon + koff);
+	std::cerr << "gene on: " << obs.getSpecies(1).statistics().mean () 
+		<< " (" << pon << ")" << std::endl;
+	std::cerr << "mean mRNA: " << obs.getSpecies(0).statistics().mean () 
+		<< " (" << (km * pon + kmbasal * (1. - pon)) / kdeg << ")" << std::endl;
+
+	// a reaction with k = 0 never fires, types outside the network do not react
+	PDL::ReactionNetwork inert;
+	int x = inert.addSpecies ("X", 0.);
+	inert.decay (x, 0.);
+	Factory G (inert, dt);
+	Rxn r (inert, G, b);
+	std::vector<Factory::Particle*> made;
+	Factory::Particle * p = G.createParticle (x0, x);
+	int fired = 0;
+	for (int i = 0; i < 1000; i++)
+		if (r.apply (p, dt, &made))
+			fired++;
+	delete p;
+	std::cerr << "k = 0: " << fired << " of 1000 fired (0), rate of an unknown type " << r.rate (x + 1) << " (0)" << std::endl;
+
+	return 1;
+}
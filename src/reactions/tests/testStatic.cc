@@ -0,0 +1,103 @@
+/* testStatic.cc  2015-08-20 immobile binding sites in the static tier
+ *
+ * Copyright (C) 2015 Svyatoslav Kondrat (Valiska)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ */
+
+#include <iostream>
+#include <map>
+#include <chrono>
+
+#include <pdlib/system.hh>
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#include <pdlib/observables/stat.hh>
+
+typedef PDL::GeometryBox<double, 3> Box;
+typedef PDL::SpeciesFactory<Box> Factory;
+typedef PDL::CompiledNetwork<Box> Rxn;
+typedef PDL::System<Box, Factory, Rxn> Sys;
+
+int main (int argc, char ** argv)
+{
+	PDL::Random::seed (1);
+
+	// binding sites release a protein now and then, and are lost slowly
+	Box::Space x0 (0.), H (10.);
+	Box b (x0, H);
+	double dt = 0.01;
+	double kp = 0.002, kdeg = 0.1, kloss = 0.005;
+	PDL::ReactionNetwork net;
+	int site = net.addSpecies ("Site", 0.);
+	int protein = net.addSpecies ("Protein", 1.);
+	net.produce (site, protein, kp);
+	net.decay (protein, kdeg);
+	net.decay (site, kloss);
+	Factory F (net, dt);
+
+	std::mt19937 engine (2);
+	int nsites = 5000, nsteps = 2000;
+	Sys system (b, F);
+	system.addReaction (Rxn (net, F, b));
+	system.enableSpatialIndex (1.);
+	for (int i = 0; i < 100; i++)
+		system.addParticle (b.randomPoint (engine), protein);
+	for (int i = 0; i < nsites; i++)
+		system.addParticle (b.randomPoint (engine), site);
+
+	std::map<int64_t, Box::Space> placed;
+	for (int i = 0; i < system.getNParticles (); i++)
+		if (system.getParticle (i)->type () == site)
+			placed[system.getParticle (i)->getNumber ()] = system.particlePosition (i);
+	// the proteins, added first, kept their order behind the tier
+	bool ordered = true;
+	for (int i = system.getNStatic () + 1; i < system.getNParticles (); i++)
+		if (system.getParticle (i)->getNumber () < system.getParticle (i - 1)->getNumber ())
+			ordered = false;
+	std::cerr << "static tier: " << system.getNStatic () << " (" << nsites << "), mobile particles "
+		<< (ordered ? "in order" : "reordered") << std::endl;
+
+	PDL::RunningStat n;
+	auto start = std::chrono::steady_clock::now ();
+	for (int k = 0; k < nsteps; k++)
+	{
+		system.evolve (dt);
+		if (k >= nsteps / 2)
+			n.push (system.getNParticles (protein));
+	}
+	double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	// sites are in front, where they were placed, and indexed
+	int misplaced = 0, moved = 0;
+	for (int i = 0; i < system.getNParticles (); i++)
+	{
+		const Sys::Particle * p = system.getParticle (i);
+		if ((p->type () == site) != (i < system.getNStatic ()))
+			misplaced++;
+		if (p->type () == site && (p->position () - placed[p->getNumber ()]).two_norm () != 0.)
+			moved++;
+	}
+	int indexed = system.countInBox (b.lower (), b.upper (), site);
+	std::cerr << system.getNParticles (site) << " sites left, " << system.getNStatic () << " static, "
+		<< misplaced << " misplaced, " << moved << " moved, " << indexed << " indexed" << std::endl;
+
+	// released proteins (started near stationary) follow the sites, s (t) kp / (kdeg - kloss)
+	double sites = 0.5 * nsites * (exp (- kloss * nsteps * dt / 2.) + exp (- kloss * nsteps * dt));
+	std::cerr << "proteins: " << n.mean () << " (about " << sites * kp / (kdeg - kloss) << "), "
+		<< elapsed / nsteps * 1e6 << " us per step" << std::endl;
+
+	return 1;
+}
@@ -27,6 +27,19 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cmath>
+
+#include <pdlib/random.hh>
+#include <pdlib/geom/cells.hh>
+#include <pdlib/io/journal.hh>
+#include <pdlib/instances.hh>
+#ifdef PDL_EXTERN_TEMPLATES
+#include <pdlib/geom/box.hh>
+#include <pdlib/reactions/network.hh>
+#endif
 
 namespace PDL 
 {
@@ -40,20 +53,90 @@ class null_reaction
 		//{std::vector<P*> l; return l;};
 };
 
-template<class Geometry, class Factory, class Reaction = null_reaction<typename Factory::Particle>>
+// reaction which fired last, if the reaction can tell (see
+// CompiledNetwork::lastReaction), for the event journal
+template<class R>
+auto lastReactionOf (const R & r, int) -> decltype (r.lastReaction ()) {return r.lastReaction ();}
+template<class R>
+int lastReactionOf (const R &, long) {return -1;}
+
+// internal state of a particle (e.g., a gene on or off), if it can tell;
+// changes are journaled as switches
+template<class P>
+auto stateOf (const P & p, int) -> decltype (p.state ()) {return p.state ();}
+template<class P>
+int stateOf (const P &, long) {return -1;}
+
+// particles which never move (e.g., BrownianParticle with D = 0) go to
+// the static tier of System, if they can tell
+template<class P>
+auto immobileOf (const P & p, int) -> decltype (p.immobile ()) {return p.immobile ();}
+template<class P>
+bool immobileOf (const P &, long) {return false;}
+
+// density for System::addParticlesWithDensity, up to normalisation
+class uniform_density
+{
+	public:
+		template<class X>
+		double operator() (const X &) const {return 1.;};
+};
+
+// observers are sampled by System::evolve after every step
+class null_observer
+{
+	public:
+		template<class S>
+		void sample (const S &) {};
+};
+
+// instrumentation of System::evolve
+struct SystemCounters
+{
+	SystemCounters () : steps (0), born (0), reacted (0), absorbed (0), seconds (0.) {};
+	unsigned long int steps;
+	unsigned long int born;     // particles made by reactions
+	unsigned long int reacted;  // particles consumed by reactions
+	unsigned long int absorbed; // particles removed at the boundary
+	double seconds;             // wall clock time spent in evolve
+};
+
+template<class Geometry, class Factory, 
+	class Reaction = null_reaction<typename Factory::Particle>, class Observer = null_observer>
 class System
 {
 	public:
 
 		typedef typename Factory::Particle Particle;
+		typedef Factory FactoryType;
+		typedef Geometry GeometryType;
+
+		typedef CellList<Geometry, Particle> SpatialIndex;
 
-		System (Geometry & G, Factory & F) : geo(G), F(F), number (0), t (0)
+		System (Geometry & G, Factory & F) : geo(G), F(F), index (nullptr), nstatic (0), number (0), stride (1), t (0), journal (nullptr)
 		{
 //			static_assert (typename Particle::Space == typename Geometry::Space, "Particle and geometry inconsistent");
 		};
 
+		// Deep copy (e.g., to split a trajectory): particles are copied, the
+		// geometry and the factory are shared, observers and the journal are
+		// not copied. Copied particles carry the same random state; see reseed ()
+		System (const System & s)
+			: geo(s.geo), F(s.F), rxnlist (s.rxnlist), index (nullptr), nstatic (s.nstatic),
+			ntype (s.ntype), number (s.number), stride (s.stride), t (s.t), counters (s.counters), journal (nullptr)
+		{
+			plist.reserve (s.plist.size());
+			for (typename std::vector<Particle*>::const_iterator ps = s.plist.begin(); ps != s.plist.end(); ++ps)
+				plist.push_back (new Particle (**ps));
+			if (s.index)
+				enableSpatialIndex (s.index->cellSize ());
+		}
+
 		~System () 
 		{
+			journal = nullptr;
+			delete index;
+			index = nullptr;
 			for (int i = getNParticles() - 1 ; i >= 0; i--)
 			{
 #ifdef DEBUG
@@ -85,25 +168,126 @@ class System
 			return addParticle (p);
 		}
 
-		bool addParticle (Particle * p)
+		// insert n particles at uniformly distributed positions,
+		// args are passed to the factory as in addParticle
+		template<typename... Args>
+		int addParticles (int n, Args... args)
+		{
+			return addParticlesWithDensity (n, uniform_density (), 1., args...);
+		}
+
+		// insert n particles distributed with density rho (x) <= rhomax
+		template<class Density, typename... Args>
+		int addParticlesWithDensity (int n, const Density & rho, double rhomax, Args... args)
+		{
+			return addParticlesFrom (n, 
+				[&] (int i, Factory & f, std::mt19937 & engine) -> Particle *
+				{
+					std::uniform_real_distribution<double> u (0., rhomax);
+					typename Geometry::Space x;
+					do
+						x = geo.randomPoint (engine);
+					while (!(u (engine) < rho (x)));
+					return f.createParticle (x, args...);
+				});
+		}
+
+		// Bulk insertion: make (i, F, engine) returns the i-th particle (or 
+		// nullptr to skip it); particles outside the geometry are dropped.
+		// Particles are created in parallel (with OpenMP) in fixed chunks with 
+		// their own random engines, then numbered and stored in order. The
+		// particles of a chunk take their seeds from a Random::Stream of the
+		// chunk, so that each engine is seeded once and a seeded run gets the
+		// same particles whatever the scheduling of the chunks.
+		template<class Maker>
+		int addParticlesFrom (int n, const Maker & make)
+		{
+			const int nchunks = 64;
+			std::vector<Particle*> newplist (n, nullptr);
+			uint64_t seed = Random::next ();
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+			for (int c = 0; c < nchunks; c++)
+			{
+				std::mt19937 engine (seed + c);
+				Random::Stream stream (Random::mix (seed + c));
+				for (int i = (long int) n * c / nchunks; i < (long int) n * (c + 1) / nchunks; i++)
+					newplist[i] = make (i, F, engine);
+			}
+
+			plist.reserve (plist.size() + n);
+			int added = 0;
+			for (int i = 0; i < n; i++)
+			{
+				Particle * p = newplist[i];
+				if (p == nullptr)
+					continue;
+				if (geo.inside (p->position()))
+				{
+					addParticle (p);
+					added++;
+				}
+				else
+					delete p;
+			}
+			return added;
+		}
+
+		bool addParticle (Particle * p);
+
+		// add a particle keeping its number, e.g., one coming from another
+		// process (see parallel/domains.hh)
+		bool adoptParticle (Particle * p);
+
+		// new particles are numbered next, next + stride, ... (e.g., so that
+		// numbers stay unique across the systems of several processes);
+		// numbers are 64 bit, as every birth uses up stride of them
+		void setNumbering (int64_t next, int stride = 1)
 		{
-			p->setNumber(number++); // to keep track of particles
-			plist.push_back(p);
-			return true;
+			number = next;
+			this->stride = stride;
 		}
+		int64_t nextNumber () const {return number;};
+
 
+		void delParticle (int number);
 
-		void delParticle (int number)
+		// remove the particles for which f (const Particle *) is true in one pass
+		template<class F>
+		int removeParticles (F f)
 		{
-			delete plist.at (number);
-			//std::cerr << "particle # " << number << " of " << getNParticles() << std::endl;
-			plist.erase (plist.begin() + number);
-			//std::cerr << "particle # " << number << " of " << getNParticles() << std::endl;
+			int removed = 0;
+			for (int i = 0; i < getNParticles(); i++)
+				if (f (static_cast<const Particle*> (plist[i])))
+				{
+					if (journal)
+						journal->record (PDL_EVENT_DEATH, t, plist[i]->getNumber(), plist[i]->type());
+					release (i);
+					removed++;
+				}
+			if (removed)
+				compact ();
+			return removed;
 		}
 
 		Particle * getParticle (int i) const {return plist.at (i);};
 		int getNParticles () const {return plist.size ();};
 
+		// Immobile particles (see immobileOf) form a static tier, the first
+		// getNStatic () particles: they take part in reactions but are
+		// skipped by the move phase, and indexed once. Adding one after
+		// mobile particles shifts these by one place, in their order (this
+		// costs O(N), so immobile particles are best added first).
+		int getNStatic () const {return nstatic;};
+
+		// number of particles of a given type, kept up to date by add/delParticle
+		int getNParticles (int type) const 
+		{
+			return (type >= 0 && type < static_cast<int> (ntype.size())) ? ntype[type] : 0;
+		};
+
 		typename Geometry::Space particlePosition (int i) 
 		{
 			Particle * p = plist.at(i); 
@@ -138,62 +322,340 @@ class System
 			return rxnlist.push_back(r);
 		}
 
+		// observers are not owned by the system
+		void addObserver (Observer * o)
+		{
+			obslist.push_back(o);
+		}
 
-		bool evolve (const double dt)
+		// Record births, deaths, absorptions and switches of particles
+		// which can tell their state (see stateOf) in a journal (not owned
+		// by the system), starting with a keyframe of the present state;
+		// nullptr stops recording. Without the keyframe, a journal
+		// suspended by a scheme which records its own events (e.g., GFRD)
+		// is resumed
+		void setJournal (EventJournal * j, bool keyframe = true)
 		{
-			// first check reactions
-			for (typename std::vector<Reaction>::iterator rxn = rxnlist.begin(); rxn != rxnlist.end(); ++rxn)
-			{
-				if ((*rxn).order == 1)
-				{
-					std::vector<Particle*> newplist;
+			journal = j;
+			if (journal && keyframe)
+				journal->keyframe (*this);
+		}
+		EventJournal * getJournal () const {return journal;};
 
-					for (int i = 0; i < getNParticles(); i++)
-					{
-						Particle * p = getParticle (i);
-						if ( (*rxn).apply (p, dt, &newplist) )
-						{
-#ifdef DEBUG						
-							std::cerr << "Removing particle " << i << std::endl;
-#endif							
-							if (p->remove())
-								delParticle (i); // this is particle number
-						}
-					}
-					for (typename std::vector<Particle*>::iterator newp = newplist.begin(); newp != newplist.end(); ++newp)
-					{
-						addParticle (*newp);
-//						plist.push_back(*newp);
-					}
-				}
+
+		// one time step: reactions, moves, absorbed particles, observers;
+		// defined below the class, as are insert, release and the other
+		// members it calls, so that with PDL_EXTERN_TEMPLATES the optimised
+		// instance in libpdlib is used (see instances.hh)
+		bool evolve (const double dt);
+
+		// Evolve until time tmax or until stop (*this) returns true after a
+		// step (see observables/convergence.hh); returns true if the run was
+		// stopped by the criterion
+		template<class Criterion>
+		bool evolveUntil (double tmax, const double dt, Criterion & stop)
+		{
+			while (t + 0.5 * dt < tmax)
+			{
+				if (!evolve (dt))
+					return false;
+				if (stop (*this))
+					return true;
 			}
+			return false;
+		}
+
+		// new random streams for all particles (derived from seed), so that
+		// copies of a system part ways
+		void reseed (uint64_t seed)
+		{
+			for (unsigned int i = 0; i < plist.size(); i++)
+				plist[i]->reseed (Random::mix (seed + i));
+		}
+
+		const std::vector<Particle*> & particleList () const {return plist;};
 
-			// now make a dynamic move
+		// Spatial queries are answered by a cell list with cells of size h
+		// which is kept up to date as particles are added, removed and moved.
+		// If not enabled explicitly, it is built on the first query.
+		void enableSpatialIndex (double h)
+		{
+			delete index;
+			index = new SpatialIndex (geo, h);
 			for (typename std::vector<Particle*>::iterator ps = plist.begin(); ps != plist.end(); ++ps)
+				index->insert (*ps);
+		}
+
+		const SpatialIndex & spatialIndex ()
+		{
+			if (!index)
 			{
-			//	(*ps)->move (dt, geo, plist);
-			//		return false;
-				if (!(*ps)->move (dt, geo))
-					return false;
+				// about two particles per cell
+				double V = 1.;
+				for (int i = 0; i < Geometry::dimension; i++)
+					V *= geo.upper()[i] - geo.lower()[i];
+				enableSpatialIndex (pow (2. * V / std::max (getNParticles(), 1), 1. / Geometry::dimension));
 			}
-			t += dt;
-			return true;
-		};
+			return *index;
+		}
 
-		std::vector<Particle*> particleList () {return plist;};
+		// number of particles (of a type if type >= 0) in a box or a sphere
+		int countInBox (const typename Geometry::Space & lo, const typename Geometry::Space & hi, int type = -1)
+		{
+			return spatialIndex().countInBox (lo, hi, type);
+		}
+
+		int countInSphere (const typename Geometry::Space & x, double r, int type = -1)
+		{
+			return spatialIndex().countInSphere (x, r, type);
+		}
+
+		// call f (const Particle *) for the particles in a box or a sphere
+		template<class F>
+		void forEachInBox (const typename Geometry::Space & lo, const typename Geometry::Space & hi, F f)
+		{
+			spatialIndex().forEachInBox (lo, hi, f);
+		}
+
+		template<class F>
+		void forEachInSphere (const typename Geometry::Space & x, double r, F f)
+		{
+			spatialIndex().forEachInSphere (x, r, f);
+		}
+
+		// k nearest particles (of a type if type >= 0), closest first
+		std::vector<const Particle*> nearest (const typename Geometry::Space & x, int k, int type = -1)
+		{
+			return spatialIndex().nearest (x, k, type);
+		}
 
 		double time () const {return t;};
+		const SystemCounters & getCounters () const {return counters;};
+
+		// for event driven engines (see gfrd/gfrd.hh), which move particles
+		// and advance the clock themselves
+		void setPosition (Particle * p, const typename Geometry::Space & x)
+		{
+			p->setPosition (x);
+			if (index)
+				index->update (p);
+		}
+		void setTime (double time) {t = time;};
+		Geometry & geometry () const {return geo;};
+		Factory & factory () const {return F;};
+
 	private:
 
 		Geometry & geo;
 		Factory & F;
 		std::vector<Particle*> plist;
 		std::vector<Reaction> rxnlist;
-		int number; // total number of particles
+		std::vector<Observer*> obslist;
+		SpatialIndex * index;
+		int nstatic; // particles in the static tier, at the front of plist
+		std::vector<int> ntype; // number of particles of each type
+		int64_t number; // number of the next particle
+		int stride; // between the numbers of new particles
 		double t; // current time
+		SystemCounters counters;
+		EventJournal * journal;
+
+		void insert (Particle * p, bool renumber = true);
+
+		// delete particle i but keep its (empty) slot, see compact ()
+		void release (int i);
+
+		// remove empty slots left by release ()
+		void compact ();
+
+		void count (const Particle * p, int n);
 
 };
 
+template<class Geometry, class Factory, class Reaction, class Observer>
+bool System<Geometry, Factory, Reaction, Observer>::addParticle (Particle * p)
+{
+	insert (p);
+	if (journal)
+		journal->record (PDL_EVENT_BIRTH, t, p->getNumber(), p->type());
+	return true;
+}
+
+template<class Geometry, class Factory, class Reaction, class Observer>
+bool System<Geometry, Factory, Reaction, Observer>::adoptParticle (Particle * p)
+{
+	insert (p, false);
+	if (journal)
+		journal->record (PDL_EVENT_BIRTH, t, p->getNumber(), p->type());
+	return true;
+}
+
+template<class Geometry, class Factory, class Reaction, class Observer>
+void System<Geometry, Factory, Reaction, Observer>::delParticle (int number)
+{
+	if (journal)
+		journal->record (PDL_EVENT_DEATH, t, plist.at (number)->getNumber(), plist[number]->type());
+	count (plist.at (number), -1);
+	if (index)
+		index->remove (plist[number]);
+	if (number < nstatic)
+		nstatic--;
+	delete plist.at (number);
+	//std::cerr << "particle # " << number << " of " << getNParticles() << std::endl;
+	plist.erase (plist.begin() + number);
+	//std::cerr << "particle # " << number << " of " << getNParticles() << std::endl;
+}
+
+template<class Geometry, class Factory, class Reaction, class Observer>
+void System<Geometry, Factory, Reaction, Observer>::insert (Particle * p, bool renumber)
+{
+	if (renumber)
+	{
+		p->setNumber(number); // to keep track of particles
+		number += stride;
+	}
+	plist.push_back(p);
+	if (immobileOf (*p, 0))
+		std::rotate (plist.begin() + nstatic++, plist.end() - 1, plist.end());
+	if (index)
+		index->insert (p);
+	count (p, 1);
+}
+
+template<class Geometry, class Factory, class Reaction, class Observer>
+void System<Geometry, Factory, Reaction, Observer>::release (int i)
+{
+	count (plist[i], -1);
+	if (index)
+		index->remove (plist[i]);
+	delete plist[i];
+	plist[i] = nullptr;
+}
+
+template<class Geometry, class Factory, class Reaction, class Observer>
+void System<Geometry, Factory, Reaction, Observer>::compact ()
+{
+	nstatic -= std::count (plist.begin(), plist.begin() + nstatic, static_cast<Particle*> (nullptr));
+	plist.erase (std::remove (plist.begin(), plist.end(), static_cast<Particle*> (nullptr)), plist.end());
+}
+
+template<class Geometry, class Factory, class Reaction, class Observer>
+void System<Geometry, Factory, Reaction, Observer>::count (const Particle * p, int n)
+{
+	int type = p->type();
+	if (type < 0)
+		return;
+	if (type >= static_cast<int> (ntype.size()))
+		ntype.resize (type + 1, 0);
+	ntype[type] += n;
+}
+
+template<class Geometry, class Factory, class Reaction, class Observer>
+bool System<Geometry, Factory, Reaction, Observer>::evolve (const double dt)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+	const double tend = t + dt; // events are stamped with the end of the step
+
+	// first check reactions
+	for (typename std::vector<Reaction>::iterator rxn = rxnlist.begin(); rxn != rxnlist.end(); ++rxn)
+	{
+		if ((*rxn).order == 1)
+		{
+			std::vector<Particle*> newplist;
+			std::vector<int> newrxn; // reactions making them, if journaled
+			bool removed = false;
+
+			for (int i = 0; i < getNParticles(); i++)
+			{
+				Particle * p = getParticle (i);
+				int state = journal ? stateOf (*p, 0) : -1;
+				bool consumed = (*rxn).apply (p, dt, &newplist);
+				if (journal && !consumed && stateOf (*p, 0) != state)
+					journal->record (PDL_EVENT_SWITCH, tend, p->getNumber(), p->type(), stateOf (*p, 0));
+				int id = -1;
+				if (journal && (consumed || newrxn.size() < newplist.size()))
+				{
+					id = lastReactionOf (*rxn, 0);
+					if (id < 0)
+						id = rxn - rxnlist.begin();
+					newrxn.resize (newplist.size(), id);
+				}
+				if (consumed)
+				{
+#ifdef DEBUG						
+					std::cerr << "Removing particle " << i << std::endl;
+#endif							
+					if (p->remove())
+					{
+						if (journal)
+							journal->record (PDL_EVENT_DEATH, tend, p->getNumber(), p->type(), id);
+						release (i);
+						removed = true;
+						counters.reacted++;
+					}
+				}
+			}
+			if (removed)
+				compact ();
+			counters.born += newplist.size();
+
+			for (unsigned int k = 0; k < newplist.size(); k++)
+			{
+				insert (newplist[k]);
+				if (journal)
+					journal->record (PDL_EVENT_BIRTH, tend, newplist[k]->getNumber(), newplist[k]->type(), newrxn[k]);
+			}
+		}
+	}
+
+	// now make a dynamic move, of the mobile particles only
+	bool absorbed = false;
+	for (typename std::vector<Particle*>::iterator ps = plist.begin() + nstatic; ps != plist.end(); ++ps)
+	{
+	//	(*ps)->move (dt, geo, plist);
+	//		return false;
+		if (!(*ps)->move (dt, geo))
+			return false;
+		if (index)
+			index->update (*ps);
+		absorbed = absorbed || (*ps)->absorbed();
+	}
+
+	// remove particles absorbed by the boundary in one pass
+	if (absorbed)
+	{
+		for (int i = nstatic; i < getNParticles(); i++)
+			if (plist[i]->absorbed())
+			{
+				if (journal)
+					journal->record (PDL_EVENT_ABSORB, tend, plist[i]->getNumber(), plist[i]->type());
+				release (i);
+				counters.absorbed++;
+			}
+		compact ();
+	}
+
+	t += dt;
+	counters.steps++;
+	if (journal)
+		journal->step (*this);
+	counters.seconds += std::chrono::duration<double> (std::chrono::steady_clock::now () - start).count ();
+
+	for (typename std::vector<Observer*>::iterator o = obslist.begin(); o != obslist.end(); ++o)
+		(*o)->sample (*this);
+
+	return true;
+}
+
+#ifdef PDL_EXTERN_TEMPLATES
+#define PDL_EXTERN(ctype, dim) \
+	extern template class CellList<GeometryBox<ctype, dim>, SpeciesParticle<GeometryBox<ctype, dim> > >; \
+	extern template class System<GeometryBox<ctype, dim>, SpeciesFactory<GeometryBox<ctype, dim> >, \
+		CompiledNetwork<GeometryBox<ctype, dim> > >;
+	PDL_INSTANCES (PDL_EXTERN)
+#undef PDL_EXTERN
+#endif
+
 }; // End of namespace PDL
 
 #endif